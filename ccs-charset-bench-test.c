@@ -0,0 +1,245 @@
+/*
+ * Coded Character Set's Character Set Parser Benchmark
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccs-charset.h>
+
+/*
+ * Reference stream parser: the original getc-based character set parser,
+ * with inheritance by plain recursion. Used as a baseline only.
+ */
+struct ref_charset {
+	unsigned short size;
+	unsigned char order, shift;
+	ccs_code_t *data;
+};
+
+static int ref_get_hdigit (FILE *f, int *digit)
+{
+	int a = getc (f);
+
+	if (a >= '0' && a <= '9') {
+		*digit = a - '0';
+		return 1;
+	}
+
+	if (a >= 'a' && a <= 'f') {
+		*digit = a - 'a' + 10;
+		return 1;
+	}
+
+	if (a != EOF)
+		ungetc (a, f);
+
+	return 0;
+}
+
+static int ref_drop_line (FILE *f)
+{
+	int a;
+
+	while ((a = getc (f)) != '\n')
+		if (a == EOF)
+			return 0;
+
+	return 1;
+}
+
+static int ref_merge (struct ref_charset *o, const char *name, int depth);
+
+static int ref_get_header (struct ref_charset *o, FILE *f, int depth)
+{
+	int a;
+	char line[78 + 1], parent[64];
+	unsigned n;
+
+	while ((a = getc (f)) == '#') {
+		if (fgets (line, sizeof (line), f) == NULL)
+			return 0;
+
+		if (sscanf (line, " Size: %u", &n) == 1)
+			o->size = n;
+		else if (sscanf (line, " Order: %u", &n) == 1)
+			o->order = n;
+		else if (sscanf (line, " Shift: %u", &n) == 1)
+			o->shift = n;
+		else if (sscanf (line, " Parent: %63s", parent) == 1 &&
+			 !ref_merge (o, parent, depth - 1))
+			return 0;
+	}
+
+	if (a != EOF)
+		ungetc (a, f);
+
+	if (o->data != NULL)
+		return 1;  /* inherited */
+
+	if (o->size == 0 || o->order == 0 || o->order > 2)
+		return 0;
+
+	o->data = calloc (o->order == 1 ? o->size : o->size * o->size,
+			  sizeof (o->data[0]));
+	return o->data != NULL;
+}
+
+static int ref_get_map (struct ref_charset *o, FILE *f)
+{
+	size_t i, idx;
+	int a, h, l, octet;
+	ccs_code_t c;
+
+	for (i = 0, idx = 0; i < o->order; ++i, idx = idx * o->size + octet) {
+		if (!ref_get_hdigit (f, &h) || !ref_get_hdigit (f, &l))
+			return 0;
+
+		if ((octet = ((h << 4) | l) - o->shift) < 0 || octet >= o->size)
+			return 0;
+	}
+
+	if ((a = getc (f)) != ' ' && a != '\t')
+		return 0;
+
+	while ((a = getc (f)) == ' ' || a == '\t') {}
+
+	ungetc (a, f);
+
+	for (i = 0, c = 0; i < 8 && ref_get_hdigit (f, &h); ++i)
+		c = (c << 4) | h;
+
+	if (i == 0)
+		return 0;
+
+	while ((a = getc (f)) == ' ' || a == '\t') {}
+
+	if (a == '#' && !ref_drop_line (f))
+		return 0;
+
+	if (a != '#' && a != '\n')
+		return 0;
+
+	o->data[idx] = c;
+	return 1;
+}
+
+static int ref_merge (struct ref_charset *o, const char *name, int depth)
+{
+	char path[256];
+	FILE *f;
+	int a, ok;
+
+	snprintf (path, sizeof (path), "charset/%s", name);
+
+	if (depth == 0 || (f = fopen (path, "r")) == NULL)
+		return 0;
+
+	for (ok = ref_get_header (o, f, depth); ok && (a = getc (f)) != EOF;)
+		if (a == '#')
+			ok = ref_drop_line (f);
+		else if (a != '\n') {
+			ungetc (a, f);
+			ok = ref_get_map (o, f);
+		}
+
+	fclose (f);
+	return ok;
+}
+
+static int ref_load (struct ref_charset *o, const char *name)
+{
+	memset (o, 0, sizeof (*o));
+
+	if (ref_merge (o, name, 10))
+		return 1;
+
+	free (o->data);
+	return 0;
+}
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double bench_ref (const char *name, int count)
+{
+	struct ref_charset ref;
+	double start = now ();
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		if (!ref_load (&ref, name))
+			return -1;
+
+		free (ref.data);
+	}
+
+	return (now () - start) / count;
+}
+
+static double bench_new (const char *name, int count)
+{
+	struct ccs_charset *set;
+	double start = now ();
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		if ((set = ccs_charset_alloc (name)) == NULL)
+			return -1;
+
+		ccs_charset_free (set);
+	}
+
+	return (now () - start) / count;
+}
+
+/*
+ * Runs both parsers by turns in several rounds and takes the best time
+ * of each to filter out the scheduler noise.
+ */
+int main (int argc, char *argv[])
+{
+	int count, round;
+	double t, t_ref = 0, t_new = 0;
+
+	if (argc < 2 || argc > 3) {
+		fprintf (stderr, "usage:\n\tccs-charset-bench-test <name> "
+				 "[count]\n");
+		return 1;
+	}
+
+	count = (argc > 2 ? atoi (argv[2]) : 1000) / 10 + 1;
+
+	for (round = 0; round < 10; ++round) {
+		if ((t = bench_ref (argv[1], count)) < 0) {
+			fprintf (stderr, "E: cannot parse %s\n", argv[1]);
+			return 1;
+		}
+
+		if (round == 0 || t < t_ref)
+			t_ref = t;
+
+		if ((t = bench_new (argv[1], count)) < 0) {
+			fprintf (stderr, "E: cannot load %s\n", argv[1]);
+			return 1;
+		}
+
+		if (round == 0 || t < t_new)
+			t_new = t;
+	}
+
+	printf ("%s: stream %.1f us, block %.1f us, speedup %.1f\n",
+		argv[1], t_ref * 1e6, t_new * 1e6, t_ref / t_new);
+	return 0;
+}
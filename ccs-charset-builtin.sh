@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# Coded Character Set's Built-in Character Set Generator
+#
+# Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Usage: ccs-charset-builtin.sh <compiler> <charset-file>...
+#
+# Compiles the character set files into images with the specified compiler
+# and writes them to standard output as C header with static const arrays
+# and the table of built-in images sorted by name.
+#
+
+set -e
+
+compile="$1"
+shift
+
+tmp=$(mktemp)
+trap 'rm -f "$tmp"' EXIT
+
+names=$(for f in "$@"; do echo "${f##*/}"; done | LC_ALL=C sort)
+
+echo '/*'
+echo ' * Generated by ccs-charset-builtin.sh, do not edit'
+echo ' */'
+
+n=0
+
+for name in $names; do
+	"$compile" "$name" "$tmp"
+
+	echo
+	echo "/* $name */"
+	echo "static _Alignas (uint32_t) const unsigned char builtin_$n[] = {"
+	od -An -v -tx1 "$tmp" | awk '{
+		s = "\t"
+
+		for (i = 1; i <= NF; ++i)
+			s = s "0x" $i ","
+
+		print s
+	}'
+	echo "};"
+
+	n=$((n + 1))
+done
+
+echo
+echo "static const struct builtin builtin[] = {"
+
+n=0
+
+for name in $names; do
+	echo "	{ \"$name\", builtin_$n, sizeof (builtin_$n) },"
+	n=$((n + 1))
+done
+
+echo "};"
@@ -0,0 +1,109 @@
+/*
+ * Coded Character Set's Character Set Internals
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_CHARSET_IMPL_H
+#define CCS_CHARSET_IMPL_H  1
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include <ccs-charset.h>
+
+/*
+ * Character set table is two-level: the row table is indexed by the first
+ * octet of code (there is only one row for single-byte sets), rows consist
+ * of 16-bit cells indexed by the last octet. Empty rows are not allocated
+ * and share one static row of zeroes. Cells in the range of surrogates,
+ * which are never mapped, refer to the table of wide codes: codes above
+ * U+FFFF, control codes and private codes.
+ *
+ * Character sets loaded via inheritance refer to the rows of the immutable
+ * shared parent table and copy a row only when it is changed. The copied
+ * rows keep the indexes of wide codes, thus the wide code table of parent
+ * is copied on inheritance as a whole. Each wide code is referred by one
+ * cell only.
+ */
+#define CCS_CELL_WIDE		0xd800u
+#define CCS_CELL_WIDE_MAX	0x800u
+
+struct ccs_rindex;
+
+struct ccs_charset {
+	unsigned short size;
+	unsigned char order, shift, depth;
+	const unsigned short **row;
+	ccs_code_t *wide;
+	unsigned short nwide, wide_size;
+	void *image;		/* mapped compiled image, if any	*/
+	size_t image_size;	/* zero for built-in image		*/
+	struct ccs_charset *parent;  /* shared table rows inherited from */
+	atomic_uint refs;
+	_Atomic (void *) rindex;	/* reverse index, built lazily	*/
+	_Atomic (void *) width;		/* width plane, built lazily	*/
+
+	/* shared table state, guarded by the shared table list lock */
+	struct ccs_charset *next;
+	char *name;
+};
+
+/*
+ * Acquires one more reference to the character set, the reference is
+ * released with ccs_charset_free.
+ */
+static inline struct ccs_charset *ccs_charset_hold (struct ccs_charset *o)
+{
+	atomic_fetch_add_explicit (&o->refs, 1, memory_order_relaxed);
+	return o;
+}
+
+typedef void *ccs_charset_build_fn (const struct ccs_charset *o);
+
+/*
+ * Returns the table stored in the slot of character set, the table is
+ * built on first use and shared by all users of the set. Returns NULL on
+ * error and sets errno.
+ */
+void *ccs_charset_lazy (struct ccs_charset *o, _Atomic (void *) *slot,
+			ccs_charset_build_fn *build);
+
+/*
+ * Returns memory size held by the character set table, its reverse index
+ * and width plane, if built. Inherited parent tables are not included: they
+ * are shared, see the parent field.
+ */
+size_t ccs_charset_memsize (const struct ccs_charset *o);
+
+/*
+ * Returns a key for the character set designation data element or zero
+ * if it is not a designation: set type in the most significant octet,
+ * then the intermediate byte (if any), the final byte, and the revision
+ * byte (if any).
+ */
+unsigned long ccs_charset_key (const struct ccs_de *de);
+
+/*
+ * Locates the character set by designation key, see ccs_charset_locate.
+ */
+struct ccs_charset *ccs_charset_locate_key (unsigned long key);
+
+/*
+ * Returns code for the character at the specified row and column, where
+ * row and column are octet values decreased by shift.
+ */
+static inline
+ccs_code_t ccs_charset_get (const struct ccs_charset *o, unsigned row,
+			    unsigned col)
+{
+	unsigned x = o->row[row][col];
+
+	return x - CCS_CELL_WIDE < CCS_CELL_WIDE_MAX ?
+	       o->wide[x - CCS_CELL_WIDE] : x;
+}
+
+#endif  /* CCS_CHARSET_IMPL_H */
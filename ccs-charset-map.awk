@@ -0,0 +1,131 @@
+#
+# Coded Character Set's Character Set Map Compiler
+#
+# Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Translates charset/map into a C header with perfect hash table of
+# designation keys: a key K is stored in slot K % MAP_SIZE, where the
+# table size is the smallest one without collisions.
+#
+
+function fail(msg) {
+	printf("%s:%d: %s\n", FILENAME, FNR, msg) > "/dev/stderr"
+	failed = 1
+	exit 1
+}
+
+function hex(s,  i, d, v) {
+	if (length(s) == 0)
+		return -1
+
+	v = 0
+
+	for (i = 1; i <= length(s); ++i) {
+		if ((d = index("0123456789abcdef", tolower(substr(s, i, 1)))) == 0)
+			return -1
+
+		v = v * 16 + d - 1
+	}
+
+	return v
+}
+
+function get_key(s,  n, part, kind, ib, fb, rb) {
+	n = split(s, part, "-")
+
+	if (n < 2 || n > 3 || !((kind = part[1]) in type))
+		return -1
+
+	if (length(part[2]) == 4) {
+		ib = hex(substr(part[2], 1, 2))
+		fb = hex(substr(part[2], 3, 2))
+
+		if (ib < 32 || ib > 47)  # 02/00 .. 02/15
+			return -1
+	}
+	else if (length(part[2]) == 2) {
+		ib = 0
+		fb = hex(part[2])
+	}
+	else
+		return -1
+
+	if (fb < 48 || fb > 126)  # 03/00 .. 07/14
+		return -1
+
+	if (n == 3) {
+		if (length(part[3]) != 2 || (rb = hex(part[3])) < 64 ||  # 04/00 .. 07/14
+		    rb > 126)
+			return -1
+	}
+	else
+		rb = 0
+
+	return ((type[kind] * 256 + ib) * 256 + fb) * 256 + rb
+}
+
+BEGIN {
+	type["c"]   = 1
+	type["c1"]  = 2
+	type["d4"]  = 3
+	type["d6"]  = 4
+	type["dm4"] = 5
+	type["dm6"] = 6
+}
+
+/^[ \t]*(#|$)/ {
+	next
+}
+
+{
+	if (NF != 2)
+		fail("syntax error")
+
+	if ((k = get_key($1)) < 0)
+		fail("invalid designation key " $1)
+
+	if (k in name)
+		fail("duplicate designation key " $1)
+
+	if ($2 !~ /^[A-Za-z0-9._-]+$/)
+		fail("invalid character set name " $2)
+
+	name[k] = $2
+	key[count++] = k
+}
+
+END {
+	if (failed)
+		exit 1
+
+	for (size = count > 0 ? count : 1;; ++size) {
+		split("", slot)
+
+		for (i = 0; i < count; ++i) {
+			if ((key[i] % size) in slot)
+				break
+
+			slot[key[i] % size] = key[i]
+		}
+
+		if (i == count)
+			break
+	}
+
+	print "/*"
+	print " * Generated from " FILENAME " by ccs-charset-map.awk, do not edit"
+	print " */"
+	print ""
+	print "#define MAP_SIZE  " size
+	print ""
+	print "static const struct map_entry map[MAP_SIZE] = {"
+
+	for (i = 0; i < size; ++i)
+		if (i in slot)
+			printf("\t[%d] = { 0x%08x, \"%s\" },\n", i,
+				slot[i], name[slot[i]])
+
+	print "};"
+}
@@ -8,241 +8,570 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include <ccs-charset.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-struct ccs_charset {
-	unsigned short size;
-	unsigned char order, shift, depth;
-	ccs_code_t *data;
+#include <ccs-control.h>
+
+#include "ccs-charset-impl.h"
+#include "ccs-final.h"
+#include "ccs-rindex.h"
+
+/*
+ * Compiled character set image, see Annex D of HLD. All fields are stored
+ * in native byte order, version field is used to detect foreign images.
+ */
+#define IMAGE_MAGIC	"\177CCS"
+#define IMAGE_VERSION	2
+
+struct image {
+	unsigned char magic[4];
+	uint16_t version;
+	uint16_t size;
+	uint8_t  order, shift;
+	uint16_t rows;		/* number of stored non-empty rows	*/
+	uint16_t wide;		/* number of wide codes			*/
+	uint16_t index[];	/* row index, zero for empty row	*/
 };
 
-static const char *get_field (struct ccs_charset *o, FILE *f)
+static const unsigned short zero_row[256];
+
+static size_t row_count (unsigned size, unsigned order)
 {
-	int a;
-	size_t i;
-	char line[77 + 1];  /* one more for trailing NUL */
-	unsigned n;
+	return order == 1 ? 1 : size;
+}
 
-	for (i = 0; (a = getc (f)) != '\n'; ++i) {
-		if (a == EOF)
-			return "unexpected end of file";
+static const char *alloc_rows (struct ccs_charset *o)
+{
+	size_t i, count = row_count (o->size, o->order);
 
-		if (i >= sizeof (line))
-			return "header line too long";
+	if ((o->row = malloc (count * sizeof (o->row[0]))) == NULL)
+		return "cannot allocate memory";
 
-		line[i] = a;
-	}
+	for (i = 0; i < count; ++i)
+		o->row[i] = zero_row;
 
-	line[i] = '\0';
+	return NULL;
+}
 
-	if (sscanf (line, " Size: %u", &n) == 1) {
-		if (o->size != 0)
-			return "size already defined";
+static int own_row (const struct ccs_charset *o, size_t i)
+{
+	return o->row[i] != zero_row &&
+	       (o->parent == NULL || o->row[i] != o->parent->row[i]);
+}
 
-		o->size = n;
+static void free_rows (struct ccs_charset *o)
+{
+	size_t i, count;
+
+	if (o->row == NULL)
+		return;
+
+	if (o->image == NULL)
+		for (i = 0, count = row_count (o->size, o->order); i < count; ++i)
+			if (own_row (o, i))
+				free ((void *) o->row[i]);
+
+	free (o->row);
+	o->row = NULL;
+
+	if (o->image == NULL)
+		free (o->wide);
+
+	o->wide  = NULL;
+	o->nwide = o->wide_size = 0;
+}
+
+static const char *
+set_code (struct ccs_charset *o, unsigned r, unsigned c, ccs_code_t code)
+{
+	unsigned short *row;
+	ccs_code_t *wide;
+	unsigned i, size;
+
+	if (!own_row (o, r)) {
+		if (code == 0 && o->row[r] == zero_row)
+			return NULL;
+
+		if ((row = malloc (o->size * sizeof (row[0]))) == NULL)
+			return "cannot allocate memory";
+
+		memcpy (row, o->row[r], o->size * sizeof (row[0]));
+		o->row[r] = row;
 	}
-	else if (sscanf (line, " Order: %u", &n) == 1) {
-		if (o->order != 0)
-			return "order already defined";
+	else
+		row = (unsigned short *) o->row[r];
 
-		o->order = n;
+	if ((i = row[c] - CCS_CELL_WIDE) < CCS_CELL_WIDE_MAX) {
+		o->wide[i] = code;  /* reuse wide slot */
+		return NULL;
 	}
-	else if (sscanf (line, " Shift: %u", &n) == 1) {
-		if (o->shift != 0)
-			return "shift already defined";
 
-		o->shift = n;
+	if (code <= 0xffff && code - CCS_CELL_WIDE >= CCS_CELL_WIDE_MAX) {
+		row[c] = code;
+		return NULL;
 	}
-	else if (strncmp (line, " Parent: ", 9) == 0)
-		return ccs_charset_merge (o, line + 9);
 
+	if (o->nwide == CCS_CELL_WIDE_MAX)
+		return "too many wide codes";
+
+	if (o->nwide == o->wide_size) {
+		size = o->wide_size == 0 ? 16 : o->wide_size * 2;
+		wide = realloc (o->wide, size * sizeof (wide[0]));
+
+		if (wide == NULL)
+			return "cannot allocate memory";
+
+		o->wide      = wide;
+		o->wide_size = size;
+	}
+
+	o->wide[o->nwide] = code;
+	row[c] = CCS_CELL_WIDE + o->nwide++;
 	return NULL;
 }
 
-static size_t zpow (size_t x, unsigned n)  /* n MUST be non-zero */
+static void init (struct ccs_charset *o, unsigned depth)
 {
-	size_t y;
+	o->size   = 0;
+	o->order  = 0;
+	o->shift  = 0;
+	o->depth  = depth;
+	o->row    = NULL;
+	o->wide   = NULL;
+	o->nwide  = 0;
+	o->wide_size = 0;
+	o->image  = NULL;
+	o->parent = NULL;
+	o->name   = NULL;
+
+	atomic_init (&o->refs, 1);
+	atomic_init (&o->rindex, NULL);
+	atomic_init (&o->width, NULL);
+}
 
-	for (y = x; n > 1; y *= x, --n) {}
+static void destroy (struct ccs_charset *o);
 
-	return y;
+static const char *load (struct ccs_charset *o, const char *name);
+
+/*
+ * Shared parent tables are loaded once and referenced by all character
+ * sets inherited from them. The table is released with the last reference.
+ */
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ccs_charset *shared;
+
+static struct ccs_charset *find_shared (const char *name)
+{
+	struct ccs_charset *p;
+
+	for (p = shared; p != NULL; p = p->next)
+		if (strcmp (p->name, name) == 0) {
+			ccs_charset_hold (p);
+			break;
+		}
+
+	return p;
 }
 
-static const char *get_header (struct ccs_charset *o, FILE *f)
+static const char *
+get_shared (const char *name, unsigned depth, struct ccs_charset **set)
 {
-	int a;
+	struct ccs_charset *o, *p;
 	const char *e;
 
-	while ((a = getc (f)) == '#')
-		if ((e = get_field (o, f)) != NULL)
-			return e;
+	pthread_mutex_lock (&shared_lock);
+	p = find_shared (name);
+	pthread_mutex_unlock (&shared_lock);
+
+	if ((*set = p) != NULL)
+		return NULL;
+
+	if ((o = malloc (sizeof (*o))) == NULL)
+		return "cannot allocate memory";
 
-	if (a != EOF)
-		ungetc (a, f);
+	init (o, depth);
 
-	if (o->data != NULL)
+	if ((o->name = strdup (name)) == NULL) {
+		e = "cannot allocate memory";
+		goto no_load;
+	}
+
+	if ((e = load (o, name)) != NULL)
+		goto no_load;
+
+	pthread_mutex_lock (&shared_lock);
+
+	if ((p = find_shared (name)) == NULL) {  /* loaded concurrently? */
+		o->next = shared;
+		shared = o;
+	}
+
+	pthread_mutex_unlock (&shared_lock);
+
+	if (p == NULL) {
+		*set = o;
 		return NULL;
+	}
 
-	if (o->size  == 0 || o->size  > 256 || (o->shift + o->size) > 256 ||
-	    o->order == 0 || o->order > 2)
-		return "no valid character parameters defined";
+	*set = p;
+no_load:
+	ccs_charset_free (o);
+	return e;
+}
 
-	o->data = calloc (zpow (o->size, o->order), sizeof (o->data[0]));
-	if (o->data == NULL)
-		return "cannot allocate memory";
+static void put_shared (struct ccs_charset *o)
+{
+	struct ccs_charset **p;
+	int last;
 
-	return NULL;
+	pthread_mutex_lock (&shared_lock);
+
+	if ((last = (atomic_fetch_sub (&o->refs, 1) == 1)))
+		for (p = &shared; *p != NULL; p = &(*p)->next)
+			if (*p == o) {
+				*p = o->next;
+				break;
+			}
+
+	pthread_mutex_unlock (&shared_lock);
+
+	if (last)
+		destroy (o);
 }
 
-static const char *drop_line (FILE *f)
+/*
+ * Inherits all mappings from the shared parent table. Rows are copied on
+ * write. If the character set is already defined then parent mappings are
+ * merged into it instead.
+ */
+static const char *inherit (struct ccs_charset *o, const char *name)
 {
-	int a;
+	struct ccs_charset *p;
+	size_t count;
+	const char *e;
+
+	if (o->row != NULL)
+		return ccs_charset_merge (o, name);
+
+	if (o->depth == 0)
+		return "inheritance depth exceeded";
+
+	if ((e = get_shared (name, o->depth, &p)) != NULL)
+		return e;
+
+	if (o->size != 0)
+		e = "size already defined";
+	else if (o->order != 0)
+		e = "order already defined";
+	else if (o->shift != 0 && p->shift != 0)
+		e = "shift already defined";
+
+	if (e != NULL)
+		goto no_inherit;
+
+	o->size  = p->size;
+	o->order = p->order;
+
+	if (p->shift != 0)
+		o->shift = p->shift;
+
+	count = row_count (o->size, o->order);
+
+	if ((o->row = malloc (count * sizeof (o->row[0]))) == NULL)
+		goto no_memory;
+
+	memcpy (o->row, p->row, count * sizeof (o->row[0]));
 
-	while ((a = getc (f)) != '\n')
-		if (a == EOF)
-			return "unexpected end of file";
+	if (p->nwide > 0) {
+		if ((o->wide = malloc (p->nwide * sizeof (o->wide[0]))) == NULL)
+			goto no_wide;
 
+		memcpy (o->wide, p->wide, p->nwide * sizeof (o->wide[0]));
+		o->nwide = o->wide_size = p->nwide;
+	}
+
+	o->parent = p;
 	return NULL;
+no_wide:
+	free (o->row);
+	o->row = NULL;
+no_memory:
+	e = "cannot allocate memory";
+no_inherit:
+	put_shared (p);
+	return e;
 }
 
-static const char *get_hdigit (FILE *f, int *digit)
+/*
+ * The character set description file is read into memory as a whole and
+ * parsed in place. The buffer is terminated with NUL, which does not match
+ * any grammar element, thus scanners stop on it without bounds checks.
+ */
+struct input {
+	const unsigned char *p, *end;
+	void *base;		/* file buffer or mapped image		*/
+	size_t len;
+	int mapped;		/* compiled image			*/
+	int builtin;		/* built-in image, not to be released	*/
+};
+
+static int get_number (const char *line, const char *name, unsigned *n)
 {
-	int a = getc (f);
+	size_t len = strlen (name);
+	unsigned x;
 
-	if (a >= '0' && a <= '9') {
-		*digit = a - '0';
-		return NULL;
+	for (; *line == ' ' || *line == '\t'; ++line) {}
+
+	if (strncmp (line, name, len) != 0)
+		return 0;
+
+	for (line += len; *line == ' ' || *line == '\t'; ++line) {}
+
+	if (*line < '0' || *line > '9')
+		return 0;
+
+	for (x = 0; *line >= '0' && *line <= '9'; ++line)
+		x = x * 10 + (*line - '0');
+
+	*n = x;
+	return 1;
+}
+
+static const char *get_field (struct ccs_charset *o, struct input *in)
+{
+	const unsigned char *eol;
+	size_t len;
+	char line[78 + 1];  /* one more for trailing NUL */
+	unsigned n;
+
+	eol = memchr (in->p, '\n', in->end - in->p);
+
+	if ((len = (eol == NULL ? in->end : eol) - in->p) >= sizeof (line))
+		return "header line too long";
+
+	if (eol == NULL)
+		return "unexpected end of file";
+
+	memcpy (line, in->p, len);
+	line[len] = '\0';
+	in->p = eol + 1;
+
+	if (get_number (line, "Size:", &n)) {
+		if (o->size != 0)
+			return "size already defined";
+
+		o->size = n;
 	}
+	else if (get_number (line, "Order:", &n)) {
+		if (o->order != 0)
+			return "order already defined";
 
-	if (a >= 'a' && a <= 'f') {
-		*digit = a - 'a' + 10;
-		return NULL;
+		o->order = n;
 	}
+	else if (get_number (line, "Shift:", &n)) {
+		if (o->shift != 0)
+			return "shift already defined";
 
-	if (a != EOF)
-		ungetc (a, f);
+		o->shift = n;
+	}
+	else if (strncmp (line, " Parent: ", 9) == 0)
+		return inherit (o, line + 9);
 
-	return "hexadecimal digit expected";
+	return NULL;
 }
 
-static const char *get_octet (FILE *f, int *octet)
+static const char *get_header (struct ccs_charset *o, struct input *in)
 {
 	const char *e;
-	int h, l;
 
-	if ((e = get_hdigit (f, &h)) != NULL ||
-	    (e = get_hdigit (f, &l)) != NULL)
-		return e;
+	while (*in->p == '#') {
+		++in->p;
+
+		if ((e = get_field (o, in)) != NULL)
+			return e;
+	}
+
+	if (o->row != NULL)
+		return NULL;
+
+	if (o->size  == 0 || o->size  > 256 || (o->shift + o->size) > 256 ||
+	    o->order == 0 || o->order > 2)
+		return "no valid character parameters defined";
+
+	return alloc_rows (o);
+}
+
+static const char *drop_line (struct input *in)
+{
+	const unsigned char *eol = memchr (in->p, '\n', in->end - in->p);
+
+	if (eol == NULL) {
+		in->p = in->end;
+		return "unexpected end of file";
+	}
 
-	*octet = (h << 4) | l;
+	in->p = eol + 1;
 	return NULL;
 }
 
-static const char *
-get_code (const struct ccs_charset *o, FILE *f, size_t *offset)
+/*
+ * Hexadecimal digit values plus one, zero for non-digits. Note that only
+ * lower case digits are allowed by the grammar.
+ */
+static const unsigned char hex[256] = {
+	['0'] = 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+	['a'] = 11, 12, 13, 14, 15, 16,
+};
+
+static const char *get_code (const struct ccs_charset *o, struct input *in,
+			     unsigned *offset)
 {
-	size_t i, idx;
-	int octet;
-	const char *e;
+	const unsigned char *p = in->p;
+	size_t i;
+	unsigned idx;
+	int h, l, octet;
 
-	for (i = 0, idx = 0; i < o->order; ++i, idx = idx * o->size + octet) {
-		if ((e = get_octet (f, &octet)) != NULL)
-			return e;
+	for (i = 0, idx = 0; i < o->order; ++i, idx = (idx << 8) | octet) {
+		if ((h = hex[p[0]]) == 0 || (l = hex[p[1]]) == 0) {
+			in->p = h == 0 ? p : p + 1;
+			return "hexadecimal digit expected";
+		}
+
+		p += 2;
+		octet = ((h - 1) << 4) | (l - 1);
 
 		if ((octet -= o->shift) < 0 || octet >= o->size)
 			return "octet value out of range";
 	}
 
+	in->p = p;
 	*offset = idx;
 	return NULL;
 }
 
-static const char *get_unicode (FILE *f, ccs_code_t *code)
+static const char *get_unicode (struct input *in, ccs_code_t *code)
 {
-	size_t i;
+	const unsigned char *p = in->p, *end = p + 8;
 	ccs_code_t c;
 	int digit;
-	const char *e;
 
-	for (i = 0, c = 0; i < 8; ++i, c = (c << 4) | digit)
-		if ((e = get_hdigit (f, &digit)) != NULL) {
-			if (i > 0)
-				break;
+	for (c = 0; p < end && (digit = hex[*p]) != 0; ++p)
+		c = (c << 4) | (digit - 1);
 
-			return e;
-		}
+	if (p == in->p)
+		return "hexadecimal digit expected";
 
+	in->p = p;
 	*code = c;
 	return NULL;
 }
 
-static const char *get_space (FILE *f)
+static const char *get_space (struct input *in)
 {
-	int a;
+	const unsigned char *p = in->p;
 
-	if ((a = getc (f)) != ' ' && a != '\t')
+	if (*p != ' ' && *p != '\t')
 		return "space or tab character expected";
 
-	while ((a = getc (f)) == ' ' || a == '\t') {}
-
-	if (a != EOF)
-		ungetc (a, f);
+	for (++p; *p == ' ' || *p == '\t'; ++p) {}
 
+	in->p = p;
 	return NULL;
 }
 
-static const char *get_eol (FILE *f)
+static const char *get_eol (struct input *in)
 {
-	int a;
+	const unsigned char *p = in->p;
 
-	while ((a = getc (f)) == ' ' || a == '\t') {}
+	for (; *p == ' ' || *p == '\t'; ++p) {}
 
-	if (a == '#')
-		return drop_line (f);
+	if (p == in->end)
+		return "end of line expected";
 
-	return a == '\n' ? NULL : "end of line expected";
+	in->p = p + 1;
+
+	if (*p == '#')
+		return drop_line (in);
+
+	return *p == '\n' ? NULL : "end of line expected";
 }
 
-static const char *get_map (const struct ccs_charset *o, FILE *f)
+/*
+ * Fast path for well-formed map lines, falls back to the generic scanners
+ * above to report an error.
+ */
+static const char *get_map (struct ccs_charset *o, struct input *in)
 {
-	const char *e;
-	size_t offset;
+	const unsigned char *p = in->p;
+	const unsigned size = o->size, shift = o->shift + 0x11;  /* biased */
+	unsigned i, h, l, octet, idx;
 	ccs_code_t code;
+	const char *e;
 
-	if ((e = get_code (o, f, &offset)) != NULL ||
-	    (e = get_space (f))            != NULL ||
-	    (e = get_unicode (f, &code))   != NULL ||
-	    (e = get_eol (f))              != NULL)
+	for (i = 0, idx = 0; i < o->order; ++i, idx = (idx << 8) | octet) {
+		if ((h = hex[p[0]]) == 0 || (l = hex[p[1]]) == 0 ||
+		    (octet = (h << 4) + l - shift) >= size)
+			goto slow;
+
+		p += 2;
+	}
+
+	if (*p != ' ' && *p != '\t')
+		goto slow;
+
+	for (++p; *p == ' ' || *p == '\t'; ++p) {}
+
+	if ((h = hex[*p]) == 0)
+		goto slow;
+
+	for (code = h - 1, i = 1, ++p; i < 8 && (h = hex[*p]) != 0; ++i, ++p)
+		code = (code << 4) | (h - 1);
+
+	if (*p != '\n')
+		goto slow;
+
+	in->p = p + 1;
+	return set_code (o, idx >> 8, idx & 0xff, code);
+slow:
+	if ((e = get_code (o, in, &idx)) != NULL ||
+	    (e = get_space (in))          != NULL ||
+	    (e = get_unicode (in, &code)) != NULL ||
+	    (e = get_eol (in))            != NULL)
 		return e;
 
-	o->data[offset] = code;
-	return NULL;
+	return set_code (o, idx >> 8, idx & 0xff, code);
 }
 
-static const char *parse (struct ccs_charset *o, FILE *f)
+static const char *parse (struct ccs_charset *o, struct input *in)
 {
 	const char *e;
-	int a;
 
-	if ((e = get_header (o, f)) != NULL)
+	if ((e = get_header (o, in)) != NULL)
 		return e;
 
-	while ((a = getc (f)) != EOF)
-		switch (a) {
+	while (in->p < in->end)
+		switch (*in->p) {
 		case '\n':
+			++in->p;
 			break;
 		case '#':
-			if ((e = drop_line (f)) != NULL)
+			++in->p;
+
+			if ((e = drop_line (in)) != NULL)
 				goto no_map;
 
 			break;
 		default:
-			ungetc (a, f);
-
-			if ((e = get_map (o, f)) != NULL)
+			if ((e = get_map (o, in)) != NULL)
 				goto no_map;
 
 			break;
@@ -250,41 +579,320 @@ static const char *parse (struct ccs_charset *o, FILE *f)
 
 	return NULL;
 no_map:
-	free (o->data);
+	free_rows (o);
+
+	if (o->parent != NULL) {
+		put_shared (o->parent);
+		o->parent = NULL;
+	}
+
 	return e;
 }
 
-static FILE *open_by_name (const char *root, const char *name)
+static size_t cells_offset (const struct image *h)
+{
+	return sizeof (*h) + row_count (h->size, h->order) * sizeof (h->index[0]);
+}
+
+static size_t wide_offset (const struct image *h)
+{
+	size_t end = cells_offset (h) + h->rows * h->size * sizeof (uint16_t);
+
+	return (end + 3) & ~(size_t) 3;  /* align wide codes */
+}
+
+static const unsigned short *image_cells (const struct image *h)
+{
+	return (const void *) ((const char *) h + cells_offset (h));
+}
+
+static const uint32_t *image_wide (const struct image *h)
 {
-	int len = snprintf (NULL, 0, "%s/%s", root, name);
-	char *path;
-	FILE *f;
+	return (const void *) ((const char *) h + wide_offset (h));
+}
+
+static const char *check_image (const struct image *h, size_t len)
+{
+	const unsigned short *cell;
+	size_t i, count;
+
+	if (len < sizeof (*h) ||
+	    memcmp (h->magic, IMAGE_MAGIC, sizeof (h->magic)) != 0)
+		return "invalid compiled character set image";
+
+	if (h->version != IMAGE_VERSION)
+		return "unsupported compiled character set image version";
+
+	if (h->size  == 0 || h->size  > 256 || (h->shift + h->size) > 256 ||
+	    h->order == 0 || h->order > 2 ||
+	    h->rows > row_count (h->size, h->order) ||
+	    h->wide > CCS_CELL_WIDE_MAX ||
+	    len != wide_offset (h) + h->wide * sizeof (uint32_t))
+		return "invalid compiled character set image";
+
+	for (i = 0, count = row_count (h->size, h->order); i < count; ++i)
+		if (h->index[i] > h->rows)
+			return "invalid compiled character set image";
+
+	for (cell = image_cells (h), i = 0; i < h->rows * h->size; ++i)
+		if (cell[i] - CCS_CELL_WIDE < CCS_CELL_WIDE_MAX &&
+		    cell[i] - CCS_CELL_WIDE >= h->wide)
+			return "invalid compiled character set image";
+
+	return NULL;
+}
+
+static const unsigned short *image_row (const struct image *h, size_t i)
+{
+	return h->index[i] == 0 ? zero_row :
+	       image_cells (h) + (h->index[i] - 1) * h->size;
+}
+
+static const char *merge_image (struct ccs_charset *o, const struct input *in)
+{
+	const struct image *h = in->base;
+	const uint32_t *wide = image_wide (h);
+	const unsigned short *row;
+	size_t i, j, count;
+	unsigned x;
+	const char *e;
+
+	if ((e = check_image (h, in->len)) != NULL)
+		return e;
+
+	if (o->row != NULL) {
+		if (o->size != h->size || o->order != h->order ||
+		    o->shift != h->shift)
+			return "character parameters mismatch";
+	}
+	else {
+		o->size  = h->size;
+		o->order = h->order;
+		o->shift = h->shift;
+
+		if ((e = alloc_rows (o)) != NULL)
+			return e;
+	}
+
+	for (i = 0, count = row_count (h->size, h->order); i < count; ++i)
+		for (row = image_row (h, i), j = 0; j < h->size; ++j) {
+			if ((x = row[j]) == 0)
+				continue;
 
-	if ((path = malloc (len + 1)) == NULL)
+			if (x - CCS_CELL_WIDE < CCS_CELL_WIDE_MAX)
+				x = wide[x - CCS_CELL_WIDE];
+
+			if ((e = set_code (o, i, j, x)) != NULL)
+				return e;
+		}
+
+	return NULL;
+}
+
+static const char *read_file (int fd, size_t len, struct input *in)
+{
+	unsigned char *p;
+	ssize_t count;
+	size_t i;
+
+	if ((p = malloc (len + 1)) == NULL)
+		return "cannot allocate memory";
+
+	for (i = 0; i < len; i += count)
+		if ((count = read (fd, p + i, len - i)) <= 0) {
+			free (p);
+			return count < 0 ? strerror (errno) :
+					   "unexpected end of file";
+		}
+
+	p[len] = '\0';
+
+	in->p       = p;
+	in->end     = p + len;
+	in->base    = p;
+	in->len     = len;
+	in->mapped  = 0;
+	in->builtin = 0;
+	return NULL;
+}
+
+#ifdef CCS_BUILTIN
+/*
+ * The character sets from charset directory are compiled into images at
+ * build time, the table of built-in images is sorted by name.
+ */
+struct builtin {
+	const char *name;
+	const unsigned char *data;
+	size_t len;
+};
+
+#include "ccs-charset-builtin.h"
+
+static int builtin_cmp (const void *key, const void *item)
+{
+	const struct builtin *b = item;
+
+	return strcmp (key, b->name);
+}
+
+static int open_builtin (const char *name, struct input *in)
+{
+	const struct builtin *b;
+
+	b = bsearch (name, builtin, sizeof (builtin) / sizeof (builtin[0]),
+		     sizeof (builtin[0]), builtin_cmp);
+	if (b == NULL)
+		return 0;
+
+	in->p       = b->data;
+	in->end     = b->data + b->len;
+	in->base    = (void *) b->data;
+	in->len     = b->len;
+	in->mapped  = 1;
+	in->builtin = 1;
+	return 1;
+}
+#else
+static int open_builtin (const char *name, struct input *in)
+{
+	(void) name;
+	(void) in;
+
+	return 0;
+}
+#endif
+
+/*
+ * Opens the named file: compiled images are mapped into memory, character
+ * set descriptions are read into buffer. On success the input structure
+ * points to the file content which must be released with close_file.
+ * Built-in character sets take precedence over files.
+ */
+static const char *open_file (const char *root, const char *name,
+			      struct input *in)
+{
+	char path[PATH_MAX];
+	int fd;
+	struct stat st;
+	char magic;
+	void *p;
+	const char *e;
+
+	if (open_builtin (name, in))
 		return NULL;
 
-	snprintf (path, len + 1, "%s/%s", root, name);
-	f = fopen (path, "r");
-	free (path);
+	if (snprintf (path, sizeof (path), "%s/%s", root, name) >=
+	    (int) sizeof (path)) {
+		errno = ENAMETOOLONG;
+		return strerror (errno);
+	}
+
+	if ((fd = open (path, O_RDONLY | O_CLOEXEC)) == -1)
+		return strerror (errno);
+
+	if (fstat (fd, &st) != 0)
+		goto no_file;
+
+	if (st.st_size == 0 || pread (fd, &magic, 1, 0) != 1 ||
+	    magic != IMAGE_MAGIC[0]) {
+		e = read_file (fd, st.st_size, in);
+		close (fd);
+		return e;
+	}
+
+	p = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		goto no_file;
+
+	close (fd);
 
-	return f;
+	in->p       = p;
+	in->end     = in->p + st.st_size;
+	in->base    = p;
+	in->len     = st.st_size;
+	in->mapped  = 1;
+	in->builtin = 0;
+	return NULL;
+no_file:
+	e = strerror (errno);
+	close (fd);
+	return e;
+}
+
+static void close_file (const struct input *in)
+{
+	if (in->builtin)
+		return;
+
+	if (in->mapped)
+		munmap (in->base, in->len);
+	else
+		free (in->base);
 }
 
 const char *ccs_charset_merge (struct ccs_charset *o, const char *name)
 {
-	FILE *f;
+	struct input in;
 	const char *e;
 
 	if (o->depth == 0)
 		return "inheritance depth exceeded";
 
-	if ((f = open_by_name ("charset", name)) == NULL)
-		return strerror (errno);
+	if (o->image != NULL)
+		return "compiled character set cannot be changed";
+
+	if ((e = open_file ("charset", name, &in)) != NULL)
+		return e;
 
 	--o->depth;
-	e = parse (o, f);
+	e = in.mapped ? merge_image (o, &in) : parse (o, &in);
 	++o->depth;
-	fclose (f);
+	close_file (&in);
+	return e;
+}
+
+static const char *load (struct ccs_charset *o, const char *name)
+{
+	struct input in;
+	const char *e;
+	const struct image *h;
+	size_t i, count;
+
+	if ((e = open_file ("charset", name, &in)) != NULL)
+		return e;
+
+	if (!in.mapped) {
+		--o->depth;
+		e = parse (o, &in);
+		++o->depth;
+		close_file (&in);
+		return e;
+	}
+
+	h = in.base;
+
+	if ((e = check_image (h, in.len)) != NULL)
+		goto no_image;
+
+	o->size  = h->size;
+	o->order = h->order;
+	o->shift = h->shift;
+
+	if ((e = alloc_rows (o)) != NULL)
+		goto no_image;
+
+	for (i = 0, count = row_count (h->size, h->order); i < count; ++i)
+		o->row[i] = image_row (h, i);
+
+	o->wide  = (ccs_code_t *) image_wide (h);  /* read-only */
+	o->nwide = o->wide_size = h->wide;
+
+	o->image      = in.base;
+	o->image_size = in.builtin ? 0 : in.len;
+	return NULL;
+no_image:
+	close_file (&in);
 	return e;
 }
 
@@ -295,31 +903,258 @@ struct ccs_charset *ccs_charset_alloc (const char *name)
 	if ((o = malloc (sizeof (*o))) == NULL)
 		return NULL;
 
-	o->size  = 0;
-	o->order = 0;
-	o->shift = 0;
-	o->depth = 10;
-	o->data  = NULL;
+	init (o, 10);
+	errno = 0;
 
-	if (name != NULL && ccs_charset_merge (o, name) != NULL)
+	if (name != NULL && load (o, name) != NULL)
 		goto no_parse;
 
 	return o;
 no_parse:
-	free (o);
+	if (errno == 0)
+		errno = EPROTO;
+
+	ccs_charset_free (o);
 	return NULL;
 }
 
-void ccs_charset_free (struct ccs_charset *o)
+static void destroy (struct ccs_charset *o)
 {
-	if (o == NULL)
-		return;
+	free_rows (o);
+	free (atomic_load (&o->rindex));
+	free (atomic_load (&o->width));
+
+	if (o->image != NULL && o->image_size != 0)
+		munmap (o->image, o->image_size);
+
+	if (o->parent != NULL)
+		put_shared (o->parent);
 
-	free (o->data);
+	free (o->name);
 	free (o);
 }
 
+void ccs_charset_free (struct ccs_charset *o)
+{
+	if (o != NULL && atomic_fetch_sub (&o->refs, 1) == 1)
+		destroy (o);
+}
+
+static int put (const void *data, size_t size, size_t count, FILE *f)
+{
+	return count == 0 || fwrite (data, size, count, f) == count;
+}
+
+const char *ccs_charset_save (const struct ccs_charset *o, FILE *f)
+{
+	struct image h;
+	size_t i, count;
+	uint16_t index, n;
+	uint32_t code, pad = 0;
+
+	if (o->row == NULL)
+		return "no valid character parameters defined";
+
+	memset (&h, 0, sizeof (h));
+	memcpy (h.magic, IMAGE_MAGIC, sizeof (h.magic));
+
+	h.version = IMAGE_VERSION;
+	h.size    = o->size;
+	h.order   = o->order;
+	h.shift   = o->shift;
+	h.wide    = o->nwide;
+
+	count = row_count (o->size, o->order);
+
+	for (i = 0; i < count; ++i)
+		if (o->row[i] != zero_row)
+			++h.rows;
+
+	if (!put (&h, sizeof (h), 1, f))
+		return strerror (errno);
+
+	for (i = 0, n = 0; i < count; ++i) {
+		index = o->row[i] == zero_row ? 0 : ++n;
+
+		if (!put (&index, sizeof (index), 1, f))
+			return strerror (errno);
+	}
+
+	for (i = 0; i < count; ++i)
+		if (o->row[i] != zero_row &&
+		    !put (o->row[i], sizeof (o->row[i][0]), o->size, f))
+			return strerror (errno);
+
+	count = wide_offset (&h) - cells_offset (&h) -
+		h.rows * h.size * sizeof (uint16_t);
+
+	if (!put (&pad, 1, count, f))
+		return strerror (errno);
+
+	for (i = 0; i < o->nwide; ++i) {
+		code = o->wide[i];
+
+		if (!put (&code, sizeof (code), 1, f))
+			return strerror (errno);
+	}
+
+	return fflush (f) == 0 ? NULL : strerror (errno);
+}
+
+void *ccs_charset_lazy (struct ccs_charset *o, _Atomic (void *) *slot,
+			ccs_charset_build_fn *build)
+{
+	void *p, *old = NULL;
+
+	if ((p = atomic_load_explicit (slot, memory_order_acquire)) != NULL)
+		return p;
+
+	if (o->row == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if ((p = build (o)) == NULL)
+		return NULL;
+
+	if (!atomic_compare_exchange_strong_explicit (slot, &old, p,
+						      memory_order_acq_rel,
+						      memory_order_acquire)) {
+		free (p);  /* built concurrently by other user */
+		p = old;
+	}
+
+	return p;
+}
+
+size_t ccs_charset_memsize (const struct ccs_charset *o)
+{
+	const struct ccs_rindex *ri = atomic_load (&o->rindex);
+	size_t i, count, size = sizeof (*o);
+
+	if (o->row == NULL)
+		return size;
+
+	count = row_count (o->size, o->order);
+	size += count * sizeof (o->row[0]);
+
+	if (ri != NULL)
+		size += ri->size;
+
+	if (atomic_load (&o->width) != NULL)
+		size += count * o->size;
+
+	if (o->image != NULL)
+		return size + o->image_size;
+
+	for (i = 0; i < count; ++i)
+		if (own_row (o, i))
+			size += o->size * sizeof (o->row[i][0]);
+
+	return size + o->wide_size * sizeof (o->wide[0]);
+}
+
+/*
+ * Character set types of designation keys, the same values are assigned
+ * to the types of charset/map file by ccs-charset-map.awk: c, c1, d4, d6,
+ * dm4 and dm6.
+ */
+enum key_type {
+	KEY_C0 = 1, KEY_C1, KEY_G94, KEY_G96, KEY_G94N, KEY_G96N,
+};
+
+static int is_intermediate (int a)
+{
+	return a >= 0x20 && a <= 0x2f;
+}
+
+static int is_final (int a)
+{
+	return a >= 0x30 && a <= 0x7e;
+}
+
+/*
+ * Designation parameters are: an optional intermediate byte, a final byte
+ * and an optional revision byte (the final byte of preceding IRR).
+ */
+static unsigned long
+make_key (unsigned type, const unsigned char *p, size_t len)
+{
+	unsigned long key = (unsigned long) type << 24;
+
+	if (len > 0 && is_intermediate (p[0])) {
+		key |= p[0] << 16;
+		++p, --len;
+	}
+
+	if (len == 0 || len > 2 || !is_final (p[0]) ||
+	    (len == 2 && (p[1] < 0x40 || p[1] > 0x7e)))
+		return 0;
+
+	key |= p[0] << 8;
+
+	if (len == 2)
+		key |= p[1];
+
+	return key;
+}
+
+unsigned long ccs_charset_key (const struct ccs_de *de)
+{
+	const unsigned char *p = de->arg;
+	size_t len = de->len < de->size ? de->len : de->size;
+
+	switch (de->code) {
+	case CCS_CZD:
+		return make_key (KEY_C0, p, len);
+	case CCS_C1D:
+		return make_key (KEY_C1, p, len);
+	case CCS_GZD4: case CCS_G1D4: case CCS_G2D4: case CCS_G3D4:
+		return make_key (KEY_G94, p, len);
+	case CCS_G1D6: case CCS_G2D6: case CCS_G3D6:
+		return make_key (KEY_G96, p, len);
+	case CCS_GDM:
+		if (len == 0)
+			return 0;
+
+		switch (p[0]) {
+		case CCS_T_GZD4: case CCS_T_G1D4: case CCS_T_G2D4:
+		case CCS_T_G3D4:
+			return make_key (KEY_G94N, p + 1, len - 1);
+		case CCS_T_G1D6: case CCS_T_G2D6: case CCS_T_G3D6:
+			return make_key (KEY_G96N, p + 1, len - 1);
+		}
+
+		return make_key (KEY_G94N, p, len);  /* ESC 02/04 F */
+	}
+
+	return 0;
+}
+
+/*
+ * The designation map is compiled from charset/map at build time into
+ * perfect hash table: a key is stored at slot key % MAP_SIZE.
+ */
+struct map_entry {
+	unsigned long key;
+	const char *name;
+};
+
+#include "ccs-charset-map.h"
+
+struct ccs_charset *ccs_charset_locate_key (unsigned long key)
+{
+	const struct map_entry *e = map + key % MAP_SIZE;
+
+	if (key == 0 || e->key != key) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	return ccs_charset_alloc (e->name);
+}
+
 struct ccs_charset *ccs_charset_locate (const struct ccs_de *de)
 {
-	return NULL;  /* not implemented yet */
+	return ccs_charset_locate_key (ccs_charset_key (de));
 }
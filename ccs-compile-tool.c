@@ -0,0 +1,53 @@
+/*
+ * Coded Character Set Compiler
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ccs-charset.h>
+
+int main (int argc, char *argv[])
+{
+	struct ccs_charset *set;
+	const char *e;
+	FILE *f;
+
+	if (argc != 3) {
+		fprintf (stderr, "usage:\n\tccs-compile <name> <output>\n");
+		return 1;
+	}
+
+	if ((set = ccs_charset_alloc (NULL)) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 1;
+	}
+
+	if ((e = ccs_charset_merge (set, argv[1])) != NULL) {
+		fprintf (stderr, "E: %s: %s\n", argv[1], e);
+		goto no_parse;
+	}
+
+	if ((f = fopen (argv[2], "wb")) == NULL) {
+		e = strerror (errno);
+		fprintf (stderr, "E: %s: %s\n", argv[2], e);
+		goto no_parse;
+	}
+
+	if ((e = ccs_charset_save (set, f)) != NULL)
+		fprintf (stderr, "E: %s: %s\n", argv[2], e);
+
+	if (fclose (f) != 0 && e == NULL)
+		fprintf (stderr, "E: %s: %s\n", argv[2], e = strerror (errno));
+
+	if (e != NULL)
+		remove (argv[2]);
+no_parse:
+	ccs_charset_free (set);
+	return e == NULL ? 0 : 1;
+}
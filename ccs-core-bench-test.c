@@ -0,0 +1,401 @@
+/*
+ * Coded Character Set Escape and Control Sequence Parser Benchmark
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccs-control.h>
+#include <ccs-core.h>
+
+#include "ccs-final.h"
+
+/*
+ * Reference parser: the original escape and control sequence parser, it
+ * neither decodes parameters nor references arguments in place. Used as
+ * a baseline and to check the results only.
+ */
+#define CODE_ESC	0xc0000000
+#define CODE_ESC_3F	0xe0000000
+#define CODE_CSI	0xf0000000
+
+#define MAX_INTER	4
+
+enum ref_state {
+	REF_GROUND = 0,
+	REF_ESC,
+	REF_ESC_INT,
+	REF_CSI_PARAM,
+	REF_CSI_INT,
+	REF_CSI_IGNORE,
+	REF_STRING,
+	REF_STRING_ESC,
+};
+
+struct ref_core {
+	unsigned char state, count;
+	unsigned short inter;
+	ccs_size_t len;
+	ccs_code_t code;
+};
+
+static int ref_start (struct ref_core *o, int state, ccs_code_t code)
+{
+	o->state = state;
+	o->count = 0;
+	o->inter = 0;
+	o->len   = 0;
+	o->code  = code;
+	return 0;
+}
+
+/*
+ * The argument is collected directly into the buffer of data element, thus
+ * the same data element should be passed until the sequence is completed.
+ */
+static void ref_put_arg (struct ref_core *o, struct ccs_de *de, int c)
+{
+	if (o->len < de->size)
+		de->arg[o->len++] = c;
+}
+
+static void ref_put_inter (struct ref_core *o, int c)
+{
+	if (o->count <= MAX_INTER)
+		++o->count;
+
+	o->inter = (o->inter << 4) | (c & 0xf);
+}
+
+static int ref_emit (struct ccs_de *de, ccs_code_t code)
+{
+	de->code = code;
+	de->len  = 0;
+	return 1;
+}
+
+static int ref_finish (struct ref_core *o, struct ccs_de *de, ccs_code_t code)
+{
+	o->state = REF_GROUND;
+
+	de->code = code;
+	de->len  = o->len;
+
+	if (o->len < de->size)
+		de->arg[o->len] = '\0';
+
+	return 1;
+}
+
+static int ref_ground (struct ref_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	switch (c) {
+	case CCS_NUL:
+	case CCS_SYN:
+		return 0;
+	case CCS_ESC:
+		return ref_start (o, REF_ESC, 0);
+	case CCS_CSI:
+		return ref_start (o, REF_CSI_PARAM, CODE_CSI);
+	case CCS_DCS:
+	case CCS_SOS:
+	case CCS_OSC:
+	case CCS_PM:
+	case CCS_APC:
+		return ref_start (o, REF_STRING, c);
+	}
+
+	return ref_emit (de, c);
+}
+
+static int ref_esc (struct ref_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	if (c < CCS_T_FP)
+		return ref_start (o, REF_ESC_INT,
+			      c == CCS_T_3FP ? CODE_ESC_3F : CODE_ESC | c);
+
+	o->state = REF_GROUND;
+
+	if (c >= CCS_T_FE && c < CCS_T_FS)
+		return ref_ground (o, c + 0x40, de);  /* Fe: C1 control */
+
+	return ref_emit (de, CODE_ESC | c);  /* Fp or Fs */
+}
+
+static int ref_esc_int (struct ref_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	const int is_3f = o->code == CODE_ESC_3F;
+
+	if (c < CCS_T_FP) {
+		if (is_3f)
+			ref_put_inter (o, c);
+		else
+			ref_put_arg (o, de, c);
+
+		return 0;
+	}
+
+	if (!is_3f) {
+		ref_put_arg (o, de, c);
+		return ref_finish (o, de, o->code);
+	}
+
+	o->state = REF_GROUND;
+
+	if (o->count > MAX_INTER)
+		return 0;
+
+	return ref_emit (de, CODE_ESC_3F | o->count << 24 | o->inter << 8 | c);
+}
+
+static int ref_csi (struct ref_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	if (c >= 0x40) {
+		if (o->state == REF_CSI_IGNORE || o->count > MAX_INTER) {
+			o->state = REF_GROUND;
+			return 0;
+		}
+
+		return ref_finish (o, de, CODE_CSI | o->count << 24 |
+				      o->inter << 8 | c);
+	}
+
+	if (c >= 0x30) {
+		if (o->state == REF_CSI_PARAM)
+			ref_put_arg (o, de, c);
+		else
+			o->state = REF_CSI_IGNORE;
+
+		return 0;
+	}
+
+	if (o->state == REF_CSI_PARAM)
+		o->state = REF_CSI_INT;
+
+	ref_put_inter (o, c);
+	return 0;
+}
+
+static int ref_string (struct ref_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	if (o->state == REF_STRING_ESC) {
+		if (c == 0x5c)  /* ESC 05/12 is ST */
+			return ref_finish (o, de, o->code);
+
+		o->state = REF_STRING;
+		ref_put_arg (o, de, CCS_ESC);
+	}
+
+	switch (c) {
+	case CCS_NUL:
+	case CCS_SYN:
+		return 0;
+	case CCS_ESC:
+		o->state = REF_STRING_ESC;
+		return 0;
+	case CCS_ST:
+		return ref_finish (o, de, o->code);
+	}
+
+	if (c <= 0xff)
+		ref_put_arg (o, de, c);
+
+	return 0;
+}
+
+__attribute__ ((noinline))
+static int ref_process (struct ref_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	if (o->state == REF_GROUND)
+		return ref_ground (o, c, de);
+
+	if (o->state >= REF_STRING)
+		return ref_string (o, c, de);
+
+	/* C0 controls are executed inside of escape and control sequences */
+	if (c < 0x20)
+		switch (c) {
+		case CCS_NUL:
+		case CCS_SYN:
+			return 0;
+		case CCS_ESC:
+			return ref_start (o, REF_ESC, 0);
+		case CCS_CAN:
+		case CCS_SUB:
+			o->state = REF_GROUND;  /* cancel sequence */
+			/* fall through */
+		default:
+			return ref_emit (de, c);
+		}
+
+	if (c == CCS_DEL)
+		return 0;
+
+	if (c > CCS_DEL) {
+		o->state = REF_GROUND;  /* abort sequence */
+		return ref_ground (o, c, de);
+	}
+
+	switch (o->state) {
+	case REF_ESC:
+		return ref_esc (o, c, de);
+	case REF_ESC_INT:
+		return ref_esc_int (o, c, de);
+	}
+
+	return ref_csi (o, c, de);
+}
+
+#define ARG_SIZE	64
+
+/*
+ * Terminal output with heavy SGR usage: short colored words and cursor
+ * movements, now and then window title and character set switches.
+ */
+static unsigned char *make_stream (size_t len)
+{
+	static const char *const word[] = {
+		"ls", "-la", "total", "drwxr-xr-x", "root", "4096", "Oct",
+		"src", "include", "Makefile", "README.md", "build",
+	};
+	unsigned char *p, *q;
+	unsigned long seed = 1;
+	size_t n = 0;
+	unsigned a;
+
+	if ((p = malloc (len + 128)) == NULL)
+		return NULL;
+
+	for (q = p; q < p + len; ++n) {
+		seed = seed * 1103515245 + 12345;
+		a = (seed >> 16) & 0x7fff;
+
+		q += sprintf ((char *) q, "\033[%u;%um%s\033[0m ", a & 1,
+			      30 + (a >> 1) % 8, word[(a >> 4) % 12]);
+
+		if ((n % 8) == 7)
+			q += sprintf ((char *) q, "\r\n\033[K");
+
+		if ((n % 64) == 63)
+			q += sprintf ((char *) q, "\033[%u;%uH", a % 25 + 1,
+				      a % 80 + 1);
+
+		if ((n % 256) == 255)
+			q += sprintf ((char *) q, "\033]0;~/src\a\033\\"
+						  "\033$B$3$s\033(B");
+	}
+
+	return p;
+}
+
+static unsigned long fold (unsigned long h, const struct ccs_de *de)
+{
+	size_t i;
+
+	h = (h ^ de->code) * 16777619;
+	h = (h ^ de->len) * 16777619;
+
+	for (i = 0; i < de->len && i < de->size; ++i)
+		h = (h ^ de->arg[i]) * 16777619;
+
+	return h;
+}
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double bench_ref (const unsigned char *p, size_t len,
+			 struct ccs_de *de, unsigned long *hash)
+{
+	struct ref_core o = {};
+	double start = now ();
+	unsigned long h = 2166136261;
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		if (ref_process (&o, p[i], de))
+			h = fold (h, de);
+
+	*hash = h;
+	return now () - start;
+}
+
+static double bench_new (const unsigned char *p, size_t len,
+			 struct ccs_de *de, unsigned long *hash)
+{
+	struct ccs_core *o;
+	double start = now ();
+	unsigned long h = 2166136261;
+	size_t i;
+
+	if ((o = ccs_core_alloc ()) == NULL)
+		return -1;
+
+	for (i = 0; i < len; ++i)
+		if (ccs_core_process (o, p[i], de))
+			h = fold (h, de);
+
+	ccs_core_free (o);
+	*hash = h;
+	return now () - start;
+}
+
+/*
+ * Runs both parsers by turns in several rounds and takes the best time
+ * of each to filter out the scheduler noise.
+ */
+int main (int argc, char *argv[])
+{
+	size_t len = (argc > 1 ? atoi (argv[1]) : 16) << 20;
+	unsigned char *p;
+	struct ccs_de *de;
+	unsigned long h_ref, h_new;
+	double t, t_ref = 0, t_new = 0;
+	int round;
+
+	if ((p = make_stream (len)) == NULL ||
+	    (de = malloc (sizeof (*de) + ARG_SIZE)) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 1;
+	}
+
+	de->size = ARG_SIZE;
+
+	for (round = 0; round < 10; ++round) {
+		t = bench_ref (p, len, de, &h_ref);
+
+		if (round == 0 || t < t_ref)
+			t_ref = t;
+
+		if ((t = bench_new (p, len, de, &h_new)) < 0) {
+			fprintf (stderr, "E: cannot create parser\n");
+			return 1;
+		}
+
+		if (round == 0 || t < t_new)
+			t_new = t;
+
+		if (h_ref != h_new) {
+			fprintf (stderr, "E: parsers results differ\n");
+			return 1;
+		}
+	}
+
+	printf ("sgr: reference %.1f MB/s, parser %.1f MB/s, ratio %.2f\n",
+		len / t_ref / 1e6, len / t_new / 1e6, t_ref / t_new);
+
+	free (de);
+	free (p);
+	return 0;
+}
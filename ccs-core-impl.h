@@ -0,0 +1,83 @@
+/*
+ * Coded Character Set Escape and Control Sequence Parser Internals
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_CORE_IMPL_H
+#define CCS_CORE_IMPL_H  1
+
+#include <ccs-core.h>
+
+enum ccs_core_state {
+	CCS_CORE_GROUND = 0,	/* not inside of sequence		*/
+	CCS_CORE_ESC,		/* ESC received				*/
+	CCS_CORE_ESC_INT,	/* ESC and intermediate bytes received	*/
+	CCS_CORE_ESC_3F,	/* ESC 02/03 and intermediates received	*/
+	CCS_CORE_CSI_PARAM,	/* CSI and parameter bytes received	*/
+	CCS_CORE_CSI_INT,	/* CSI intermediate bytes received	*/
+	CCS_CORE_CSI_IGNORE,	/* malformed control sequence		*/
+	CCS_CORE_STRING,	/* inside of control string		*/
+	CCS_CORE_STRING_ESC,	/* ESC received inside of control string */
+};
+
+struct ccs_core {
+	unsigned char state;
+	unsigned char count;	/* number of intermediate bytes		*/
+	unsigned short inter;	/* lower digits of intermediate bytes	*/
+	ccs_size_t len;		/* length of argument collected		*/
+	unsigned char stream;	/* pass control strings in chunks	*/
+	unsigned char utf8;	/* control strings are coded in UTF-8	*/
+	ccs_code_t code;	/* code of sequence being parsed	*/
+	const unsigned char *span;	/* argument in caller buffer	*/
+};
+
+/*
+ * Returns non-zero if parser is not inside of escape sequence, control
+ * sequence or control string, thus the next code from GL, GR or U window
+ * will be passed as is.
+ */
+static inline int ccs_core_ground (const struct ccs_core *o)
+{
+	return o->state == CCS_CORE_GROUND;
+}
+
+/*
+ * Processes the octet from the input buffer of bulk caller, the argument
+ * is referenced in that buffer while its octets are contiguous instead of
+ * copying them into the data element.
+ */
+int ccs_core_process_at (struct ccs_core *o, const unsigned char *p,
+			 struct ccs_de *de);
+
+/*
+ * Copies the argument referenced in place into the data element.
+ */
+void ccs_core_spill (struct ccs_core *o, struct ccs_de *de);
+
+/*
+ * Consumes the leading run of content octets of control string from the
+ * input buffer of bulk caller, returns the number of octets consumed.
+ */
+size_t ccs_core_string_run (struct ccs_core *o, const unsigned char *p,
+			    size_t len, struct ccs_de *de);
+
+static inline int ccs_core_string (const struct ccs_core *o)
+{
+	return o->state == CCS_CORE_STRING;
+}
+
+/*
+ * Detaches the input buffer of bulk caller at the end of the call: the
+ * argument of unfinished sequence is copied into the data element.
+ */
+static inline void ccs_core_detach (struct ccs_core *o, struct ccs_de *de)
+{
+	if (!ccs_core_ground (o))
+		ccs_core_spill (o, de);
+}
+
+#endif  /* CCS_CORE_IMPL_H */
@@ -0,0 +1,493 @@
+/*
+ * Coded Character Set Escape and Control Sequence Parser
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ccs-control.h>
+
+#include "ccs-core-impl.h"
+#include "ccs-final.h"
+
+/*
+ * Private codes for sequences, see Annex C of HLD
+ */
+#define CODE_ESC	0xc0000000
+#define CODE_ESC_3F	0xe0000000
+#define CODE_CSI	0xf0000000
+
+#define MAX_INTER	4	/* maximum number of coded intermediates */
+
+/*
+ * The parser is instantiated twice: for per-code calls, where the argument
+ * is always copied, and for bulk calls, where it is referenced in place.
+ */
+#ifdef __GNUC__
+#define INLINE	inline __attribute__ ((always_inline))
+#else
+#define INLINE	inline
+#endif
+
+size_t ccs_core_size (void)
+{
+	return sizeof (struct ccs_core);
+}
+
+struct ccs_core *ccs_core_init (void *buf, size_t size)
+{
+	struct ccs_core *o = buf;
+
+	if (size < sizeof (*o)) {
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	o->state = CCS_CORE_GROUND;
+	o->count = 0;
+	o->inter = 0;
+	o->len   = 0;
+	o->code  = 0;
+	o->stream = 0;
+	o->utf8  = 0;
+	o->span  = NULL;
+	return o;
+}
+
+struct ccs_core *ccs_core_alloc (void)
+{
+	struct ccs_core *o;
+
+	if ((o = malloc (sizeof (*o))) == NULL)
+		return NULL;
+
+	return ccs_core_init (o, sizeof (*o));
+}
+
+void ccs_core_free (struct ccs_core *o)
+{
+	free (o);
+}
+
+void ccs_core_set_stream (struct ccs_core *o, int on)
+{
+	o->stream = on != 0;
+}
+
+static int start (struct ccs_core *o, ccs_code_t code)
+{
+	o->count = 0;
+	o->inter = 0;
+	o->len   = 0;
+	o->code  = code;
+	o->span  = NULL;
+	return 0;
+}
+
+void ccs_core_spill (struct ccs_core *o, struct ccs_de *de)
+{
+	if (o->span == NULL)
+		return;
+
+	memcpy (de->arg, o->span, o->len);
+	de->data = de->arg;
+	o->span  = NULL;
+}
+
+/*
+ * The argument is collected directly into the buffer of data element, thus
+ * the same data element should be passed until the sequence is completed.
+ * For bulk calls the argument is referenced in the input buffer of caller
+ * instead, while its octets are contiguous there.
+ */
+static INLINE int put_arg (struct ccs_core *o, struct ccs_de *de, int c,
+		    const unsigned char *at)
+{
+	if (o->len >= de->size)
+		return 0;
+
+	if (at == NULL)
+		de->arg[o->len] = c;
+	else if (o->len == 0)
+		o->span = at;
+	else if (o->span == NULL || o->span + o->len != at) {
+		ccs_core_spill (o, de);
+		de->arg[o->len] = c;
+	}
+
+	++o->len;
+	return 0;
+}
+
+/*
+ * The ESC of control string precedes the octet being processed, thus it
+ * is always copied.
+ */
+static INLINE int put_esc (struct ccs_core *o, struct ccs_de *de,
+		    const unsigned char *at)
+{
+	if (at != NULL)
+		ccs_core_spill (o, de);
+
+	if (o->len < de->size)
+		de->arg[o->len++] = CCS_ESC;
+
+	return 0;
+}
+
+static void set_data (const struct ccs_core *o, struct ccs_de *de)
+{
+	de->len  = o->len;
+	de->data = o->span != NULL ? o->span : de->arg;
+
+	if (o->len < de->size)
+		de->arg[o->len] = '\0';
+}
+
+/*
+ * The first parameter is opened on the start of control sequence, each
+ * separator opens the next one. The number of parameters is limited on
+ * finish only, thus the digits of dropped parameters are ignored.
+ */
+static void start_param (struct ccs_de *de)
+{
+	struct ccs_param *p = &de->param;
+
+	p->count    = 1;
+	p->mark     = 0;
+	p->sub      = 0;
+	p->omit     = 1;
+	p->value[0] = 0;
+}
+
+static INLINE int put_digit (struct ccs_core *o, struct ccs_de *de, int c,
+		      const unsigned char *at)
+{
+	struct ccs_param *p = &de->param;
+	unsigned i = p->count - 1, v;
+
+	if (i < CCS_PARAM_MAX) {
+		v = p->value[i] * 10 + (c - '0');
+		p->value[i] = v < 0xffff ? v : 0xffff;
+		p->omit &= ~(1u << i);
+	}
+
+	return put_arg (o, de, c, at);
+}
+
+static INLINE int put_sep (struct ccs_core *o, struct ccs_de *de, int c,
+		    const unsigned char *at)
+{
+	struct ccs_param *p = &de->param;
+	unsigned i = p->count;
+
+	if (i < CCS_PARAM_MAX) {
+		p->value[i] = 0;
+		p->omit |= 1u << i;
+		p->sub  |= (c == ':') << i;
+	}
+
+	if (p->count < 0xff)
+		++p->count;
+
+	return put_arg (o, de, c, at);
+}
+
+static INLINE int put_mark (struct ccs_core *o, struct ccs_de *de, int c,
+		     const unsigned char *at)
+{
+	if (de->param.mark == 0)
+		de->param.mark = c;
+
+	return put_arg (o, de, c, at);
+}
+
+static int put_inter (struct ccs_core *o, int c)
+{
+	if (o->count <= MAX_INTER)
+		++o->count;
+
+	o->inter = (o->inter << 4) | (c & 0xf);
+	return 0;
+}
+
+/*
+ * In stream mode the collected content of control string is passed as a
+ * chunk as soon as one octet of argument buffer is left. Thus the ESC
+ * of string, which is stored before the octet following it is processed,
+ * always fits.
+ */
+static INLINE int put_str (struct ccs_core *o, struct ccs_de *de, int c,
+		    const unsigned char *at)
+{
+	if (c >= 0)
+		put_arg (o, de, c, at);
+
+	if (!o->stream || o->len == 0 || o->len + 1 < de->size)
+		return 0;
+
+	de->code = CCS_CHUNK;
+	set_data (o, de);
+
+	o->len  = 0;
+	o->span = NULL;
+	return 1;
+}
+
+static int emit (struct ccs_de *de, ccs_code_t code)
+{
+	de->code = code;
+	de->len  = 0;
+	return 1;
+}
+
+static int finish (struct ccs_core *o, struct ccs_de *de, ccs_code_t code)
+{
+	de->code = code;
+	set_data (o, de);
+	return 1;
+}
+
+static ccs_code_t get_seq (const struct ccs_core *o, ccs_code_t base, int c)
+{
+	return base | o->count << 24 | o->inter << 8 | c;
+}
+
+/*
+ * Content octets of control string change neither state nor the elements
+ * produced, thus a run of them is added to the argument referenced in the
+ * input buffer in one step. The run is cut so that no chunk is filled in
+ * stream mode, the rest of string is processed per code. The octet of ST
+ * may be a part of UTF-8 sequence, it is processed per code as well.
+ */
+size_t ccs_core_string_run (struct ccs_core *o, const unsigned char *p,
+			    size_t len, struct ccs_de *de)
+{
+	size_t n, room, limit;
+
+	if (o->len > 0 && (o->span == NULL || o->span + o->len != p) &&
+	    o->len < de->size)
+		return 0;  /* argument copied already */
+
+	limit = o->stream ? (de->size > 1 ? de->size - 2 : 0) : de->size;
+	room  = limit > o->len ? limit - o->len : 0;
+
+	if (o->stream && len > room)
+		len = room;
+
+	for (n = 0; n < len; ++n)
+		if (p[n] == CCS_NUL || p[n] == CCS_SYN || p[n] == CCS_ESC ||
+		    p[n] == CCS_ST)
+			break;
+
+	if (n > 0 && o->len == 0)
+		o->span = p;
+
+	o->len += n < room ? n : room;
+	return n;
+}
+
+static INLINE int ground (struct ccs_core *o, ccs_code_t c,
+			  struct ccs_de *de)
+{
+	switch (c) {
+	case CCS_NUL:
+	case CCS_SYN:
+		return 0;
+	case CCS_ESC:
+		o->state = CCS_CORE_ESC;
+		return start (o, CODE_ESC | c);
+	case CCS_CSI:
+		o->state = CCS_CORE_CSI_PARAM;
+		start_param (de);
+		return start (o, CODE_CSI);
+	case CCS_DCS:
+	case CCS_SOS:
+	case CCS_OSC:
+	case CCS_PM:
+	case CCS_APC:
+		o->state = CCS_CORE_STRING;
+		start (o, c);
+		return o->stream && emit (de, c);
+	}
+
+	return emit (de, c);
+}
+
+/*
+ * The ST of control string may be an octet of UTF-8 sequence, then it is
+ * a content of string.
+ */
+static INLINE int string (struct ccs_core *o, ccs_code_t c,
+			  struct ccs_de *de, const unsigned char *at)
+{
+	if (o->state == CCS_CORE_STRING_ESC) {
+		if (c == CCS_ST - 0x40)  /* ESC 05/12 is ST */
+			goto finish;
+
+		o->state = CCS_CORE_STRING;
+		put_esc (o, de, at);
+	}
+
+	switch (c) {
+	case CCS_NUL:
+	case CCS_SYN:
+		return put_str (o, de, -1, at);
+	case CCS_ESC:
+		o->state = CCS_CORE_STRING_ESC;
+		return put_str (o, de, -1, at);
+	case CCS_ST:
+		if (o->utf8)
+			return put_str (o, de, c, at);
+
+		goto finish;
+	}
+
+	return put_str (o, de, c > 0xff ? -1 : (int) c, at);
+finish:
+	o->state = CCS_CORE_GROUND;
+	return finish (o, de, o->stream ? CCS_ST : o->code);
+}
+
+static INLINE int esc (struct ccs_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	if (c < CCS_T_FP) {
+		o->state = c == CCS_T_3FP ? CCS_CORE_ESC_3F : CCS_CORE_ESC_INT;
+		return start (o, CODE_ESC | c);
+	}
+
+	o->state = CCS_CORE_GROUND;
+
+	if (c >= CCS_T_FE && c < CCS_T_FS)
+		return ground (o, c + 0x40, de);  /* Fe: C1 control */
+
+	return emit (de, CODE_ESC | c);  /* Fp or Fs */
+}
+
+static INLINE int esc_int (struct ccs_core *o, ccs_code_t c,
+			   struct ccs_de *de, const unsigned char *at)
+{
+	put_arg (o, de, c, at);
+
+	if (c < CCS_T_FP)
+		return 0;
+
+	o->state = CCS_CORE_GROUND;
+	return finish (o, de, o->code);
+}
+
+static INLINE int esc_3f (struct ccs_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	if (c < CCS_T_FP)
+		return put_inter (o, c);
+
+	o->state = CCS_CORE_GROUND;
+	return o->count <= MAX_INTER && emit (de, get_seq (o, CODE_ESC_3F, c));
+}
+
+/*
+ * Parameter bytes after intermediate bytes make the control sequence
+ * malformed, it is ignored up to its final byte.
+ */
+static INLINE int csi (struct ccs_core *o, ccs_code_t c, struct ccs_de *de,
+		       const unsigned char *at)
+{
+	int state = o->state;
+
+	if (c >= CCS_T_FE) {
+		o->state = CCS_CORE_GROUND;
+
+		if (state == CCS_CORE_CSI_IGNORE)
+			return 0;
+
+		if (de->param.count > CCS_PARAM_MAX)
+			de->param.count = CCS_PARAM_MAX;
+
+		return o->count <= MAX_INTER &&
+		       finish (o, de, get_seq (o, CODE_CSI, c));
+	}
+
+	if (c >= CCS_T_FP) {
+		if (state != CCS_CORE_CSI_PARAM) {
+			o->state = CCS_CORE_CSI_IGNORE;
+			return 0;
+		}
+
+		if (c <= '9')
+			return put_digit (o, de, c, at);
+
+		if (c <= ';')
+			return put_sep (o, de, c, at);
+
+		return put_mark (o, de, c, at);
+	}
+
+	if (state == CCS_CORE_CSI_IGNORE)
+		return 0;
+
+	o->state = CCS_CORE_CSI_INT;
+	return put_inter (o, c);
+}
+
+static INLINE int process (struct ccs_core *o, ccs_code_t c,
+			   struct ccs_de *de, const unsigned char *at)
+{
+	if (o->state == CCS_CORE_GROUND)
+		return ground (o, c, de);
+
+	if (o->state >= CCS_CORE_STRING)
+		return string (o, c, de, at);
+
+	/* C0 controls are executed inside of escape and control sequences */
+	if (c < CCS_SP)
+		switch (c) {
+		case CCS_NUL:
+		case CCS_SYN:
+			return 0;
+		case CCS_ESC:
+			o->state = CCS_CORE_ESC;
+			return start (o, CODE_ESC | c);
+		case CCS_CAN:
+		case CCS_SUB:
+			o->state = CCS_CORE_GROUND;  /* cancel sequence */
+			/* fall through */
+		default:
+			return emit (de, c);
+		}
+
+	if (c == CCS_DEL)
+		return 0;
+
+	if (c > CCS_DEL) {
+		o->state = CCS_CORE_GROUND;  /* abort sequence */
+		return ground (o, c, de);
+	}
+
+	switch (o->state) {
+	case CCS_CORE_ESC:
+		return esc (o, c, de);
+	case CCS_CORE_ESC_INT:
+		return esc_int (o, c, de, at);
+	case CCS_CORE_ESC_3F:
+		return esc_3f (o, c, de);
+	}
+
+	return csi (o, c, de, at);
+}
+
+int ccs_core_process (struct ccs_core *o, ccs_code_t c, struct ccs_de *de)
+{
+	return process (o, c, de, NULL);
+}
+
+int ccs_core_process_at (struct ccs_core *o, const unsigned char *p,
+			 struct ccs_de *de)
+{
+	return process (o, *p, de, p);
+}
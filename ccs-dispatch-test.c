@@ -0,0 +1,258 @@
+/*
+ * Coded Character Set Callback Dispatch Test
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccs-control.h>
+#include <ccs-dispatch.h>
+
+#include "ccs-test-file.h"
+
+#define ARG_SIZE	64
+#define CHUNK_SIZE	1000	/* not aligned to catch boundary errors	*/
+
+struct sink {
+	FILE *to;
+	size_t count;		/* number of codes and elements seen	*/
+	int misrouted;		/* element passed to wrong handler	*/
+};
+
+static void show (FILE *to, const struct ccs_de *de)
+{
+	size_t i;
+
+	if (to == NULL)
+		return;
+
+	if (de->code == CCS_TEXT)
+		for (i = 0; i < de->len; ++i)
+			fprintf (to, "%08lx\n", (unsigned long) de->text[i]);
+	else if (de->len == 0)
+		fprintf (to, "%08lx\n", (unsigned long) de->code);
+	else
+		fprintf (to, "%08lx %.*s\n", (unsigned long) de->code,
+			 (int) de->len, de->data);
+}
+
+static int by_code (const unsigned char *p, size_t len, struct ccs_de *de,
+		    struct sink *s)
+{
+	struct ccs *o;
+	size_t i;
+
+	if ((o = ccs_alloc ()) == NULL)
+		return 0;
+
+	for (i = 0; i < len; ++i)
+		if (ccs_process (o, p[i], de)) {
+			show (s->to, de);
+			s->count += de->code == CCS_TEXT ? de->len : 1;
+		}
+
+	ccs_free (o);
+	return 1;
+}
+
+static void on_text (void *cookie, const ccs_code_t *text, size_t len)
+{
+	struct sink *s = cookie;
+	size_t i;
+
+	if (s->to != NULL)
+		for (i = 0; i < len; ++i)
+			fprintf (s->to, "%08lx\n", (unsigned long) text[i]);
+
+	s->count += len;
+}
+
+static int on_control (void *cookie, const struct ccs_de *de)
+{
+	struct sink *s = cookie;
+
+	show (s->to, de);
+	++s->count;
+	return 0;
+}
+
+static int on_sgr (void *cookie, const struct ccs_de *de)
+{
+	struct sink *s = cookie;
+
+	s->misrouted |= de->code != CCS_SGR;
+	return on_control (cookie, de);
+}
+
+static int on_cup (void *cookie, const struct ccs_de *de)
+{
+	struct sink *s = cookie;
+
+	s->misrouted |= de->code != CCS_CUP;
+	return on_control (cookie, de);
+}
+
+/*
+ * Stops processing on each line feed to check that caller can resume
+ */
+static int on_lf (void *cookie, const struct ccs_de *de)
+{
+	struct sink *s = cookie;
+
+	s->misrouted |= de->code != CCS_LF;
+	on_control (cookie, de);
+	return 1;
+}
+
+static struct ccs_dispatch *make_table (void)
+{
+	struct ccs_dispatch *d;
+
+	if ((d = ccs_dispatch_alloc ()) == NULL)
+		return NULL;
+
+	ccs_dispatch_set_text    (d, on_text);
+	ccs_dispatch_set_default (d, on_control);
+
+	if (!ccs_dispatch_set (d, CCS_SGR, on_sgr) ||
+	    !ccs_dispatch_set (d, CCS_CUP, on_cup) ||
+	    !ccs_dispatch_set (d, CCS_LF,  on_lf)) {
+		ccs_dispatch_free (d);
+		return NULL;
+	}
+
+	return d;
+}
+
+static int by_dispatch (const unsigned char *p, size_t len, struct ccs_de *de,
+			struct sink *s)
+{
+	struct ccs_dispatch *d;
+	struct ccs *o;
+	size_t chunk, i;
+
+	if ((d = make_table ()) == NULL)
+		return 0;
+
+	if ((o = ccs_alloc ()) == NULL) {
+		ccs_dispatch_free (d);
+		return 0;
+	}
+
+	for (; len > 0; p += chunk, len -= chunk) {
+		chunk = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+
+		for (i = 0; i < chunk; )
+			i += ccs_dispatch (d, o, p + i, chunk - i, de, s);
+	}
+
+	ccs_free (o);
+	ccs_dispatch_free (d);
+	return 1;
+}
+
+typedef int process_fn (const unsigned char *p, size_t len,
+			struct ccs_de *de, struct sink *s);
+
+static double measure (process_fn *fn, const unsigned char *p, size_t len,
+		       struct ccs_de *de, int rounds)
+{
+	struct sink s = { NULL, 0, 0 };
+	clock_t start = clock ();
+	int i;
+
+	for (i = 0; i < rounds; ++i)
+		if (!fn (p, len, de, &s))
+			return 0;
+
+	return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+static int compare (const unsigned char *p, size_t len, struct ccs_de *de)
+{
+	struct sink a = { NULL, 0, 0 }, b = { NULL, 0, 0 };
+	char *x = NULL, *y = NULL;
+	size_t xlen, ylen;
+	int ok;
+
+	if ((a.to = open_memstream (&x, &xlen)) == NULL ||
+	    (b.to = open_memstream (&y, &ylen)) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 0;
+	}
+
+	ok = by_code (p, len, de, &a) & by_dispatch (p, len, de, &b);
+
+	fclose (a.to);
+	fclose (b.to);
+
+	if (!ok)
+		fprintf (stderr, "E: cannot create processor\n");
+	else if (b.misrouted) {
+		fprintf (stderr, "E: element passed to wrong handler\n");
+		ok = 0;
+	}
+	else if (xlen != ylen || memcmp (x, y, xlen) != 0) {
+		fprintf (stderr, "E: code and dispatch processing differ\n");
+		ok = 0;
+	}
+	else
+		printf ("%zu codes and elements dispatched\n", b.count);
+
+	free (x);
+	free (y);
+	return ok;
+}
+
+int main (int argc, char *argv[])
+{
+	int rounds = 0, ok = 1;
+	unsigned char *p;
+	size_t len;
+	struct ccs_de *de;
+	double a, b;
+
+	if (argc > 3 && strcmp (argv[1], "-n") == 0) {
+		rounds = atoi (argv[2]);
+		argc -= 2, argv += 2;
+	}
+
+	if (argc != 2) {
+		fprintf (stderr, "usage:\n\tccs-dispatch-test [-n <rounds>] "
+				 "<file>\n");
+		return 1;
+	}
+
+	if ((p = read_file (argv[1], &len)) == NULL) {
+		perror (argv[1]);
+		return 1;
+	}
+
+	if ((de = malloc (sizeof (*de) + ARG_SIZE)) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		free (p);
+		return 1;
+	}
+
+	de->size = ARG_SIZE;
+
+	if (rounds == 0)
+		ok = compare (p, len, de);
+	else {
+		a = measure (by_code,     p, len, de, rounds);
+		b = measure (by_dispatch, p, len, de, rounds);
+
+		printf ("code:     %8.2f MB/s\n", len * rounds / a / 1e6);
+		printf ("dispatch: %8.2f MB/s\n", len * rounds / b / 1e6);
+	}
+
+	free (de);
+	free (p);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/*
+ * Coded Character Set Callback Dispatch
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <ccs-dispatch.h>
+
+#include "ccs-impl.h"
+
+/*
+ * Slots of the dispatch table: C0 and C1 codes are used as is, then
+ * ESC Fp, ESC Fs and ESC nF codes, control sequences without intermediate
+ * bytes and control sequences with one intermediate byte follow. Other
+ * codes are passed to the default handler.
+ */
+#define SLOT_ESC	0x80	/* + F, ESC 02/00 — ESC 07/15	*/
+#define SLOT_CSI	0x100	/* + F - 04/00, CSI F		*/
+#define SLOT_CSI1	0x140	/* + I * 64 + F - 04/00, CSI I F	*/
+#define SLOT_COUNT	0x540
+
+struct ccs_dispatch {
+	ccs_text_fn *text;
+	ccs_control_fn *fallback;
+	ccs_control_fn *slot[SLOT_COUNT];
+};
+
+struct ccs_dispatch *ccs_dispatch_alloc (void)
+{
+	struct ccs_dispatch *o;
+	size_t i;
+
+	if ((o = malloc (sizeof (*o))) == NULL)
+		return NULL;
+
+	o->text     = NULL;
+	o->fallback = NULL;
+
+	for (i = 0; i < SLOT_COUNT; ++i)
+		o->slot[i] = NULL;
+
+	return o;
+}
+
+void ccs_dispatch_free (struct ccs_dispatch *o)
+{
+	free (o);
+}
+
+static unsigned get_slot (ccs_code_t c)
+{
+	if (c < 0xa0)
+		return c;
+
+	if (c >= 0xc0000020 && c <= 0xc000007f)
+		return SLOT_ESC + (c & 0x7f);
+
+	if ((c & 0xffffffc0) == 0xf0000040)
+		return SLOT_CSI + (c & 0x3f);
+
+	if ((c & 0xfffff0c0) == 0xf1000040)
+		return SLOT_CSI1 + ((c >> 8) & 0xf) * 64 + (c & 0x3f);
+
+	return SLOT_COUNT;
+}
+
+int ccs_dispatch_set (struct ccs_dispatch *o, ccs_code_t code,
+		      ccs_control_fn *fn)
+{
+	unsigned i;
+
+	if (ccs_is_text (code) || (i = get_slot (code)) == SLOT_COUNT) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	o->slot[i] = fn;
+	return 1;
+}
+
+void ccs_dispatch_set_text (struct ccs_dispatch *o, ccs_text_fn *fn)
+{
+	o->text = fn;
+}
+
+void ccs_dispatch_set_default (struct ccs_dispatch *o, ccs_control_fn *fn)
+{
+	o->fallback = fn;
+}
+
+static int call (const struct ccs_dispatch *d, const struct ccs_de *de,
+		 void *cookie)
+{
+	unsigned i = get_slot (de->code);
+	ccs_control_fn *fn = i < SLOT_COUNT ? d->slot[i] : NULL;
+
+	if (fn == NULL && (fn = d->fallback) == NULL)
+		return 0;
+
+	return fn (cookie, de);
+}
+
+size_t ccs_dispatch (const struct ccs_dispatch *d, struct ccs *o,
+		     const void *in, size_t len, struct ccs_de *de,
+		     void *cookie)
+{
+	const unsigned char *p = in, *end = p + len;
+	size_t n;
+
+	for (; p < end; p += n) {
+		n = (size_t) (end - p);
+
+		if (!ccs_next (o, p, &n, de))
+			continue;
+
+		if (de->code == CCS_TEXT) {
+			if (d->text != NULL)
+				d->text (cookie, de->text, de->len);
+		}
+		else if (call (d, de, cookie))
+			return p + n - (const unsigned char *) in;
+	}
+
+	return p - (const unsigned char *) in;
+}
@@ -0,0 +1,265 @@
+/*
+ * Coded Character Set Encoder Test
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccs.h>
+#include <ccs-encoder.h>
+
+#include "ccs-test-file.h"
+
+#define ARG_SIZE	64
+#define OUT_SIZE	100	/* small to catch output boundary errors */
+
+struct codes {
+	ccs_code_t *code;
+	size_t len, size;
+};
+
+static int push (struct codes *o, ccs_code_t c)
+{
+	ccs_code_t *p;
+
+	if (o->len == o->size) {
+		o->size = o->size == 0 ? 4096 : o->size * 2;
+
+		if ((p = realloc (o->code, o->size * sizeof (p[0]))) == NULL)
+			return 0;
+
+		o->code = p;
+	}
+
+	o->code[o->len++] = c;
+	return 1;
+}
+
+/*
+ * Decodes the input into characters and C0 controls, control functions
+ * with private codes and arguments are dropped.
+ */
+static int decode (const unsigned char *p, size_t len, struct codes *out)
+{
+	struct {
+		struct ccs_de de;
+		unsigned char arg[ARG_SIZE];
+	} e;
+	ccs_code_t buf[256];
+	struct ccs *o;
+	size_t n, count, i;
+	int ok = 1;
+
+	if ((o = ccs_alloc ()) == NULL)
+		return 0;
+
+	e.de.size = ARG_SIZE;
+
+	for (out->len = 0; ok && len > 0; p += n, len -= n) {
+		count = 256;
+		n = ccs_decode (o, p, len, buf, &count, &e.de);
+
+		for (i = 0; ok && i < count; ++i)
+			if (buf[i] <= 0x10ffff)
+				ok = push (out, buf[i]);
+	}
+
+	ccs_free (o);
+	return ok;
+}
+
+static struct ccs_encoder *make_encoder (int argc, char *argv[])
+{
+	struct ccs_encoder *o;
+	struct {
+		struct ccs_de de;
+		unsigned char arg[8];
+	} e;
+	int i;
+
+	if ((o = ccs_encoder_alloc ()) == NULL)
+		return NULL;
+
+	for (i = 0; i < argc; ++i) {
+		e.de.code = 0xc0000000 | (unsigned char) argv[i][0];
+		e.de.size = sizeof (e.arg);
+		e.de.len  = strlen (argv[i] + 1);
+
+		memcpy (e.de.arg, argv[i] + 1,
+			e.de.len < e.de.size ? e.de.len : e.de.size);
+
+		if (!ccs_encoder_add (o, &e.de)) {
+			perror (argv[i]);
+			ccs_encoder_free (o);
+			return NULL;
+		}
+	}
+
+	return o;
+}
+
+/*
+ * Encodes the codes, characters which cannot be encoded are removed from
+ * the input array.
+ */
+static int encode (struct ccs_encoder *o, struct codes *in, FILE *to)
+{
+	unsigned char buf[OUT_SIZE];
+	size_t i, j, n, size, skipped = 0;
+
+	for (i = 0, j = 0; i < in->len; i += n) {
+		size = sizeof (buf);
+		n = ccs_encode (o, in->code + i, in->len - i, buf, &size);
+
+		if (to != NULL)
+			fwrite (buf, 1, size, to);
+
+		memmove (in->code + j, in->code + i, n * sizeof (in->code[0]));
+		j += n;
+
+		if (i + n < in->len && errno == EILSEQ)
+			++n, ++skipped;
+	}
+
+	in->len = j;
+
+	size = sizeof (buf);
+
+	if (!ccs_encoder_reset (o, buf, &size))
+		return 0;
+
+	if (to != NULL) {
+		fwrite (buf, 1, size, to);
+
+		if (skipped > 0)
+			fprintf (stderr, "W: %zu characters cannot be "
+					 "encoded\n", skipped);
+	}
+
+	return 1;
+}
+
+static int get_element (const char *seq)
+{
+	if (seq[0] == '$')
+		return seq[1] >= '(' && seq[1] <= '/' ? seq[1] & 3 : 0;
+
+	return seq[0] & 3;
+}
+
+/*
+ * The first set given for each element is designated initially by the
+ * encoder, thus these designations are prepended to the decoder input.
+ */
+static void put_initial (FILE *to, int argc, char *argv[])
+{
+	int seen = 0, i, g, len;
+	const char *p;
+
+	for (i = 0; i < argc; ++i) {
+		if ((seen & (1 << (g = get_element (argv[i])))) != 0)
+			continue;
+
+		for (p = argv[i] + 1; *p >= 0x20 && *p <= 0x2f; ++p) {}
+
+		len = strlen (argv[i]);
+
+		if (strlen (p) == 2)  /* revised registration */
+			fprintf (to, "\033&%c", argv[i][--len]);
+
+		fprintf (to, "\033%.*s", len, argv[i]);
+		seen |= 1 << g;
+	}
+}
+
+static int round_trip (struct ccs_encoder *o, struct codes *in,
+		       int argc, char *argv[])
+{
+	struct codes out = {};
+	char *p = NULL;
+	size_t len;
+	FILE *f;
+	int ok;
+
+	if ((f = open_memstream (&p, &len)) == NULL)
+		return 0;
+
+	put_initial (f, argc, argv);
+	ok = encode (o, in, f);
+	fclose (f);
+
+	if (ok)
+		fwrite (p, 1, len, stdout);
+
+	if (!ok || !decode ((unsigned char *) p, len, &out)) {
+		fprintf (stderr, "E: no enough memory\n");
+		ok = 0;
+	}
+	else if (in->len != out.len ||
+		 memcmp (in->code, out.code, in->len * sizeof (in->code[0]))) {
+		fprintf (stderr, "E: decoded output differs from input\n");
+		ok = 0;
+	}
+
+	free (out.code);
+	free (p);
+	return ok;
+}
+
+int main (int argc, char *argv[])
+{
+	int rounds = 0, ok = 1, i;
+	struct ccs_encoder *o;
+	struct codes in = {};
+	unsigned char *p;
+	size_t len;
+	clock_t start;
+	double t;
+
+	if (argc > 3 && strcmp (argv[1], "-n") == 0) {
+		rounds = atoi (argv[2]);
+		argc -= 2, argv += 2;
+	}
+
+	if (argc < 3) {
+		fprintf (stderr, "usage:\n\tccs-encoder-test [-n <rounds>] "
+				 "<file> <designation>...\n");
+		return 1;
+	}
+
+	if ((p = read_file (argv[1], &len)) == NULL) {
+		perror (argv[1]);
+		return 1;
+	}
+
+	if ((o = make_encoder (argc - 2, argv + 2)) == NULL ||
+	    !decode (p, len, &in)) {
+		free (p);
+		return 1;
+	}
+
+	if (rounds == 0)
+		ok = round_trip (o, &in, argc - 2, argv + 2);
+	else {
+		start = clock ();
+
+		for (i = 0; ok && i < rounds; ++i)
+			ok = encode (o, &in, NULL);
+
+		t = (double) (clock () - start) / CLOCKS_PER_SEC;
+
+		printf ("encode: %8.2f Mchars/s\n", in.len * rounds / t / 1e6);
+	}
+
+	ccs_encoder_free (o);
+	free (in.code);
+	free (p);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+/*
+ * Coded Character Set Encoder
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ccs-control.h>
+#include <ccs-encoder.h>
+#include <ccs-pool.h>
+
+#include "ccs-final.h"
+#include "ccs-rindex.h"
+
+#define SET_MAX	16
+#define SEQ_MAX	8	/* ESC 02/06 R ESC I I F			*/
+#define OUT_MAX	(SEQ_MAX + 4)
+
+/*
+ * Sets are tried in order of addition. The set designated to G0 is used
+ * via GL, the set designated to G1 is used via GR, the sets designated to
+ * G2 and G3 are used via single shifts. The first set added for each
+ * element is designated initially, G0 without set holds ASCII graphics.
+ */
+struct set {
+	struct ccs_charset *cs;
+	const struct ccs_rindex *ri;
+	unsigned char g;	/* graphic set element: 0 — 3		*/
+	unsigned char len;	/* length of designation sequence	*/
+	unsigned char seq[SEQ_MAX];
+};
+
+struct ccs_encoder {
+	struct set set[SET_MAX];
+	unsigned count;
+	signed char cur[4];	/* designated sets, -1 if none		*/
+	signed char init[4];	/* initially designated sets		*/
+};
+
+struct ccs_encoder *ccs_encoder_alloc (void)
+{
+	struct ccs_encoder *o;
+	size_t i;
+
+	if ((o = malloc (sizeof (*o))) == NULL)
+		return NULL;
+
+	o->count = 0;
+
+	for (i = 0; i < 4; ++i)
+		o->cur[i] = o->init[i] = -1;
+
+	return o;
+}
+
+void ccs_encoder_free (struct ccs_encoder *o)
+{
+	size_t i;
+
+	if (o == NULL)
+		return;
+
+	for (i = 0; i < o->count; ++i)
+		ccs_charset_free (o->set[i].cs);
+
+	free (o);
+}
+
+static int invalid (void)
+{
+	errno = EINVAL;
+	return 0;
+}
+
+/*
+ * Returns graphic set element for designation or -1 if data element is
+ * not a graphic set designation.
+ */
+static int get_element (const struct ccs_de *de)
+{
+	switch (de->code) {
+	case CCS_GDM:
+		return de->len > 0 &&
+		       de->arg[0] >= CCS_T_GZD4 && de->arg[0] <= CCS_T_G3D6 ?
+		       de->arg[0] & 3 : 0;  /* ESC 02/04 F is G0 */
+	case CCS_GZD4: case CCS_G1D4: case CCS_G2D4: case CCS_G3D4:
+	case CCS_G1D6: case CCS_G2D6: case CCS_G3D6:
+		return de->code & 3;
+	}
+
+	return -1;
+}
+
+/*
+ * Builds the designation escape sequence: the revision byte, if any,
+ * follows the final byte and is sent via IRR first.
+ */
+static int make_seq (struct set *s, const struct ccs_de *de)
+{
+	size_t len = de->len < de->size ? de->len : de->size, i, n = 0;
+
+	for (i = 0; i < len && de->arg[i] >= 0x20 && de->arg[i] <= 0x2f; ++i) {}
+
+	if (i + 1 > len || i + 2 < len || len + 4 > SEQ_MAX)
+		return 0;
+
+	if (i + 2 == len) {
+		s->seq[n++] = CCS_ESC;
+		s->seq[n++] = CCS_T_IRR;
+		s->seq[n++] = de->arg[--len];
+	}
+
+	s->seq[n++] = CCS_ESC;
+	s->seq[n++] = de->code & 0xff;
+
+	memcpy (s->seq + n, de->arg, len);
+	s->len = n + len;
+	return 1;
+}
+
+int ccs_encoder_add (struct ccs_encoder *o, const struct ccs_de *de)
+{
+	struct ccs_pool *pool;
+	struct set *s = o->set + o->count;
+	int g;
+
+	if (o->count >= SET_MAX || (g = get_element (de)) < 0 ||
+	    !make_seq (s, de))
+		return invalid ();
+
+	if ((pool = ccs_pool_default ()) == NULL ||
+	    (s->cs = ccs_pool_get_charset (pool, de)) == NULL)
+		return 0;
+
+	if (s->cs->order > 2) {
+		errno = EINVAL;
+		goto error;
+	}
+
+	if ((s->ri = ccs_charset_rindex (s->cs)) == NULL)
+		goto error;
+
+	s->g = g;
+
+	if (o->init[g] < 0)
+		o->init[g] = o->cur[g] = o->count;
+
+	++o->count;
+	return 1;
+error:
+	ccs_charset_free (s->cs);
+	return 0;
+}
+
+static int is_fixed (unsigned x)
+{
+	return x == CCS_SP || x == CCS_DEL;
+}
+
+/*
+ * Returns the octets of character from the set or zero if the set has no
+ * such character. Positions of SP and DEL are not available in GL.
+ */
+static unsigned lookup (const struct set *s, ccs_code_t c)
+{
+	unsigned x = ccs_rindex_get (s->ri, c);
+
+	if (s->g != 1 && (is_fixed (x & 0xff) || is_fixed (x >> 8)))
+		return 0;
+
+	return x;
+}
+
+static size_t put_char (const struct set *s, unsigned x, unsigned char *p)
+{
+	const unsigned mask = s->g == 1 ? 0x80 : 0;
+	size_t n = 0;
+
+	if (s->g > 1) {
+		p[n++] = CCS_ESC;
+		p[n++] = (s->g == 2 ? CCS_SS2 : CCS_SS3) - 0x40;
+	}
+
+	if (x > 0xff)
+		p[n++] = (x >> 8) | mask;
+
+	p[n++] = (x & 0xff) | mask;
+	return n;
+}
+
+/*
+ * Stores the octets of character into p and returns their count or zero
+ * if the character cannot be encoded. The set to designate, if any, is
+ * returned in next.
+ */
+static size_t
+encode (const struct ccs_encoder *o, ccs_code_t c, unsigned char *p, int *next)
+{
+	const struct set *s;
+	unsigned g, x;
+	int i;
+
+	switch (c) {
+	case CCS_SO: case CCS_SI: case CCS_ESC:
+	case CCS_SS2: case CCS_SS3: case CCS_CSI:
+		return 0;  /* would change the meaning of following octets */
+	case CCS_DCS: case CCS_SOS: case CCS_OSC: case CCS_PM: case CCS_APC:
+		p[0] = CCS_ESC;  /* empty control string */
+		p[1] = c - 0x40;
+		p[2] = CCS_ESC;
+		p[3] = CCS_ST - 0x40;
+		return 4;
+	}
+
+	if (c < 0x20 || c == CCS_SP || c == CCS_DEL) {
+		p[0] = c;
+		return 1;
+	}
+
+	if (c >= 0x80 && c < 0xa0) {
+		p[0] = CCS_ESC;
+		p[1] = c - 0x40;
+		return 2;
+	}
+
+	for (g = 0; g < 4; ++g)
+		if ((i = o->cur[g]) >= 0 &&
+		    (x = lookup (s = o->set + i, c)) != 0)
+			return put_char (s, x, p);
+
+	if (o->cur[0] < 0 && c < 0x7f) {
+		p[0] = c;
+		return 1;
+	}
+
+	for (i = 0; i < (int) o->count; ++i)
+		if (o->cur[(s = o->set + i)->g] != i &&
+		    (x = lookup (s, c)) != 0) {
+			memcpy (p, s->seq, s->len);
+			*next = i;
+			return s->len + put_char (s, x, p + s->len);
+		}
+
+	return 0;
+}
+
+size_t ccs_encode (struct ccs_encoder *o, const ccs_code_t *in, size_t len,
+		   void *out, size_t *size)
+{
+	unsigned char *p = out, buf[OUT_MAX], *to;
+	size_t avail = *size, i, n;
+	int next;
+
+	for (i = 0; i < len; ++i) {
+		to = avail < OUT_MAX ? buf : p;
+		next = -1;
+
+		if ((n = encode (o, in[i], to, &next)) == 0) {
+			errno = EILSEQ;
+			break;
+		}
+
+		if (n > avail) {
+			errno = ENOBUFS;
+			break;
+		}
+
+		if (to == buf)
+			memcpy (p, buf, n);
+
+		p += n;
+		avail -= n;
+
+		if (next >= 0)
+			o->cur[o->set[next].g] = next;
+	}
+
+	*size -= avail;
+	return i;
+}
+
+int ccs_encoder_reset (struct ccs_encoder *o, void *out, size_t *size)
+{
+	unsigned char *p = out;
+	size_t n, g;
+
+	for (n = 0, g = 0; g < 4; ++g)
+		if (o->cur[g] != o->init[g])
+			n += o->set[o->init[g]].len;
+
+	if (n > *size) {
+		errno = ENOBUFS;
+		return 0;
+	}
+
+	for (g = 0; g < 4; ++g)
+		if (o->cur[g] != o->init[g]) {
+			memcpy (p, o->set[o->init[g]].seq,
+				o->set[o->init[g]].len);
+			p += o->set[o->init[g]].len;
+			o->cur[g] = o->init[g];
+		}
+
+	*size = n;
+	return 1;
+}
@@ -0,0 +1,113 @@
+/*
+ * Coded Character Set Processor Internals
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_IMPL_H
+#define CCS_IMPL_H  1
+
+#include <ccs.h>
+
+#include "ccs-core-impl.h"
+#include "ccs-map-impl.h"
+
+#define CCS_RUN_MAX	256
+
+struct ccs {
+	struct ccs_core *core;
+	struct ccs_map *map;
+	ccs_code_t key[6];	/* designation keys of C0, C1, G0 — G3	*/
+	unsigned char irr;	/* revision byte from IRR, zero if none	*/
+	unsigned char utf8;	/* UTF-8 coding system is in effect	*/
+	unsigned char need;	/* UTF-8 continuation octets pending	*/
+	unsigned char lo, hi;	/* range of the next continuation octet	*/
+	ccs_code_t part;	/* UTF-8 character pending		*/
+	ccs_code_t run[CCS_RUN_MAX];	/* text run of ccs_next	*/
+};
+
+/*
+ * Returns non-zero if code is a graphic character, SP or DEL
+ */
+static inline int ccs_is_text (ccs_code_t c)
+{
+	return (c >= 0x20 && c < 0x80) || (c >= 0xa0 && c < 0xc0000000);
+}
+
+/*
+ * Returns non-zero if the next octets from GL window are mapped directly:
+ * no sequence is being parsed and no shift or multiple-byte character is
+ * pending.
+ */
+static inline int ccs_gl_direct (const struct ccs *o)
+{
+	return !o->utf8 && ccs_core_ground (o->core) &&
+	       ccs_map_gl_direct (o->map);
+}
+
+/*
+ * Returns non-zero if the next octets from GL window are passed as is
+ */
+static inline int ccs_gl_ascii (const struct ccs *o)
+{
+	return !o->utf8 && ccs_core_ground (o->core) &&
+	       ccs_map_gl_ascii (o->map);
+}
+
+/*
+ * Returns non-zero if the next octets are UTF-8 text: UTF-8 is in effect,
+ * no sequence is being parsed and no character is pending.
+ */
+static inline int ccs_utf8_direct (const struct ccs *o)
+{
+	return o->utf8 && o->need == 0 && ccs_core_ground (o->core);
+}
+
+/*
+ * Decodes the leading run of UTF-8 text of at most count characters, see
+ * ccs_scan_utf8, returns the number of octets consumed and stores the
+ * number of characters into count. Display width flags are added to the
+ * codes if enabled.
+ */
+size_t ccs_utf8_text (const struct ccs *o, const unsigned char *p, size_t len,
+		      ccs_code_t *out, size_t *count);
+
+/*
+ * Consumes the leading run of content octets of control string being
+ * parsed, if any, returns the number of octets consumed.
+ */
+static inline size_t ccs_string_run (struct ccs *o, const unsigned char *p,
+				     size_t len, struct ccs_de *de)
+{
+	return ccs_core_string (o->core) ?
+	       ccs_core_string_run (o->core, p, len, de) : 0;
+}
+
+#define CCS_AGAIN	2
+
+/*
+ * Processes the octet from the input buffer of bulk call, the arguments
+ * of sequences are referenced in that buffer while possible. The buffer
+ * should be detached at the end of the call, see ccs_core_detach. Returns
+ * CCS_AGAIN if the octet breaks UTF-8 character pending: U+FFFD is passed
+ * for that character, then the octet should be processed again.
+ */
+int ccs_process_at (struct ccs *o, const unsigned char *p, struct ccs_de *de);
+
+/*
+ * Processes the octet at the input position and advances the position
+ * unless the octet should be processed again.
+ */
+static inline int ccs_process_step (struct ccs *o, const unsigned char **p,
+				    struct ccs_de *de)
+{
+	int ret = ccs_process_at (o, *p, de);
+
+	*p += ret != CCS_AGAIN;
+	return ret;
+}
+
+#endif  /* CCS_IMPL_H */
@@ -0,0 +1,185 @@
+/*
+ * Coded Character Set Checkpoint Index Test
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ccs-index.h>
+
+#include "ccs-test-file.h"
+
+#define ARG_SIZE	64
+#define STEP		1000	/* small step to catch state errors	*/
+#define BLOCK_SIZE	777	/* not aligned to step			*/
+#define SEEKS		32
+
+static void show (FILE *to, const struct ccs_de *de)
+{
+	size_t i;
+
+	if (de->code == CCS_TEXT)
+		for (i = 0; i < de->len; ++i)
+			fprintf (to, "%08lx\n", (unsigned long) de->text[i]);
+	else if (de->len == 0)
+		fprintf (to, "%08lx\n", (unsigned long) de->code);
+	else
+		fprintf (to, "%08lx %.*s\n", (unsigned long) de->code,
+			 (int) de->len, de->data);
+}
+
+/*
+ * Decodes the input from the offset given, the position of output for
+ * each input octet is stored into mark array, if any.
+ */
+static int decode (struct ccs *o, const unsigned char *p, size_t len,
+		   size_t from, struct ccs_de *de, FILE *to, long *mark)
+{
+	size_t i;
+
+	de->size = ARG_SIZE;
+
+	for (i = from; i < len; ++i) {
+		if (mark != NULL)
+			mark[i] = ftell (to);
+
+		if (ccs_process (o, p[i], de))
+			show (to, de);
+	}
+
+	return fflush (to) == 0;
+}
+
+static struct ccs_index *build (const unsigned char *p, size_t len)
+{
+	struct ccs_index *o;
+	size_t i, n;
+	FILE *f;
+
+	if ((o = ccs_index_alloc (STEP)) == NULL)
+		return NULL;
+
+	for (i = 0; i < len; i += n) {
+		n = len - i < BLOCK_SIZE ? len - i : BLOCK_SIZE;
+
+		if (!ccs_index_build (o, p + i, n))
+			goto error;
+	}
+
+	if ((f = tmpfile ()) == NULL)
+		goto error;
+
+	if (ccs_index_save (o, f) != NULL)
+		goto no_save;
+
+	ccs_index_free (o);
+	rewind (f);
+	o = ccs_index_load (f);
+	fclose (f);
+	return o;
+no_save:
+	fclose (f);
+error:
+	ccs_index_free (o);
+	return NULL;
+}
+
+/*
+ * Decoding from the checkpoint found for the offset should give the same
+ * output as the decoding of the whole input from that checkpoint on.
+ */
+static int test (const struct ccs_index *x, const unsigned char *p,
+		 size_t len, struct ccs_de *de, const char *ref, size_t ref_len,
+		 const long *mark, unsigned long long offset)
+{
+	struct ccs *o;
+	char *s = NULL;
+	size_t slen;
+	FILE *f;
+	int ok;
+
+	if ((o = ccs_alloc ()) == NULL || !ccs_index_seek (x, o, &offset) ||
+	    (f = open_memstream (&s, &slen)) == NULL) {
+		perror ("E: cannot seek");
+		ccs_free (o);
+		return 0;
+	}
+
+	ok = decode (o, p, len, offset, de, f, NULL);
+	fclose (f);
+	ccs_free (o);
+
+	if (ok && offset < len && (ref_len - mark[offset] != slen ||
+	    memcmp (ref + mark[offset], s, slen) != 0)) {
+		fprintf (stderr, "E: decoding from checkpoint %llu differs\n",
+			 offset);
+		ok = 0;
+	}
+
+	free (s);
+	return ok;
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned char *p;
+	size_t len, ref_len;
+	struct ccs_de *de;
+	long *mark;
+	char *ref = NULL;
+	FILE *f;
+	struct ccs *o;
+	struct ccs_index *x;
+	unsigned long seed = 1;
+	int i, ok;
+
+	if (argc != 2) {
+		fprintf (stderr, "usage:\n\tccs-index-test <file>\n");
+		return 1;
+	}
+
+	if ((p = read_file (argv[1], &len)) == NULL) {
+		perror (argv[1]);
+		return 1;
+	}
+
+	de   = malloc (sizeof (*de) + ARG_SIZE);
+	mark = malloc ((len + 1) * sizeof (mark[0]));
+
+	if (de == NULL || mark == NULL ||
+	    (f = open_memstream (&ref, &ref_len)) == NULL ||
+	    (o = ccs_alloc ()) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 1;
+	}
+
+	ok = decode (o, p, len, 0, de, f, mark);
+	ccs_free (o);
+	fclose (f);
+
+	if (!ok || (x = build (p, len)) == NULL) {
+		perror ("E: cannot build index");
+		return 1;
+	}
+
+	ok = test (x, p, len, de, ref, ref_len, mark, 0) &
+	     test (x, p, len, de, ref, ref_len, mark, len);
+
+	for (i = 0; i < SEEKS && len > 0; ++i) {
+		seed = seed * 1103515245 + 12345;
+		ok &= test (x, p, len, de, ref, ref_len, mark,
+			    (seed >> 8) % len);
+	}
+
+	ccs_index_free (x);
+	free (ref);
+	free (mark);
+	free (de);
+	free (p);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,524 @@
+/*
+ * Coded Character Set Checkpoint Index
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ccs-index.h>
+
+#include "ccs-impl.h"
+
+/*
+ * Checkpoint index file, see Annex E of HLD. All fields are stored in
+ * little-endian byte order without padding, field by field, thus the index
+ * does not depend on the host.
+ */
+#define INDEX_MAGIC	"\177CCI"
+#define INDEX_VERSION	1
+
+#define HEADER_SIZE	24
+#define STATE_SIZE	32
+
+struct header {
+	unsigned char magic[4];
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t states;	/* number of distinct states		*/
+	uint32_t count;		/* number of checkpoints		*/
+	uint64_t step;		/* checkpoint interval			*/
+};
+
+/*
+ * Checkpoints are taken outside of escape sequences, control sequences,
+ * control strings and UTF-8 characters only, thus neither the parser state
+ * nor the UTF-8 character pending is stored.
+ */
+struct state {
+	uint32_t set[6];	/* keys of C0, C1, G0 — G3 sets		*/
+	uint8_t  gl, gr, ss, irr;
+	uint16_t lead;
+	uint8_t  utf8;
+	uint8_t  reserved;
+};
+
+#define ARG_SIZE	64
+#define OUT_SIZE	256
+#define STATE_LOOKUP	16	/* the last distinct states to reuse	*/
+
+struct ccs_index {
+	uint64_t step;
+	struct state *state;
+	size_t states, states_size;
+	uint64_t *offset;
+	uint32_t *index;
+	size_t count, size;
+
+	/* builder, not present for index loaded */
+	struct ccs *proc;
+	struct ccs_de *de;
+	uint64_t pos, next;
+};
+
+static void put_state (struct state *o, const struct ccs_state *s)
+{
+	size_t i;
+
+	memset (o, 0, sizeof (*o));
+
+	for (i = 0; i < 6; ++i)
+		o->set[i] = s->set[i];
+
+	o->gl   = s->gl;
+	o->gr   = s->gr;
+	o->ss   = s->ss;
+	o->irr  = s->irr;
+	o->lead = s->lead;
+	o->utf8 = s->utf8;
+}
+
+static void get_state (const struct state *o, struct ccs_state *s)
+{
+	size_t i;
+
+	memset (s, 0, sizeof (*s));
+
+	for (i = 0; i < 6; ++i)
+		s->set[i] = o->set[i];
+
+	s->gl   = o->gl;
+	s->gr   = o->gr;
+	s->ss   = o->ss;
+	s->irr  = o->irr;
+	s->lead = o->lead;
+	s->utf8 = o->utf8;
+}
+
+/*
+ * Returns the index of the state, the state is added if it is not found
+ * among the last distinct states. Returns -1 if no memory.
+ */
+static long find_state (struct ccs_index *o, const struct state *s)
+{
+	size_t i, stop;
+	struct state *p;
+
+	stop = o->states > STATE_LOOKUP ? o->states - STATE_LOOKUP : 0;
+
+	for (i = o->states; i > stop; --i)
+		if (memcmp (o->state + i - 1, s, sizeof (*s)) == 0)
+			return i - 1;
+
+	if (o->states == o->states_size) {
+		i = o->states_size == 0 ? 16 : o->states_size * 2;
+
+		if ((p = realloc (o->state, i * sizeof (*p))) == NULL)
+			return -1;
+
+		o->state = p;
+		o->states_size = i;
+	}
+
+	o->state[o->states] = *s;
+	return o->states++;
+}
+
+static int add (struct ccs_index *o, uint64_t offset,
+		const struct ccs_state *s)
+{
+	struct state state;
+	long i;
+	size_t size;
+	uint64_t *p;
+	uint32_t *q;
+
+	if (o->count == o->size) {
+		size = o->size == 0 ? 64 : o->size * 2;
+
+		if ((p = realloc (o->offset, size * sizeof (*p))) == NULL)
+			return 0;
+
+		o->offset = p;
+
+		if ((q = realloc (o->index, size * sizeof (*q))) == NULL)
+			return 0;
+
+		o->index = q;
+		o->size  = size;
+	}
+
+	put_state (&state, s);
+
+	if ((i = find_state (o, &state)) < 0)
+		return 0;
+
+	o->offset[o->count] = offset;
+	o->index[o->count]  = i;
+	++o->count;
+	return 1;
+}
+
+static struct ccs_index *index_alloc (uint64_t step)
+{
+	struct ccs_index *o;
+
+	if ((o = malloc (sizeof (*o))) == NULL)
+		return NULL;
+
+	o->step   = step;
+	o->state  = NULL;
+	o->states = o->states_size = 0;
+	o->offset = NULL;
+	o->index  = NULL;
+	o->count  = o->size = 0;
+	o->proc   = NULL;
+	o->de     = NULL;
+	o->pos    = 0;
+	o->next   = step;
+	return o;
+}
+
+struct ccs_index *ccs_index_alloc (size_t step)
+{
+	struct ccs_index *o;
+	struct ccs_state s;
+
+	if (step == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if ((o = index_alloc (step)) == NULL)
+		return NULL;
+
+	if ((o->proc = ccs_alloc ()) == NULL ||
+	    (o->de = malloc (sizeof (*o->de) + ARG_SIZE)) == NULL)
+		goto error;
+
+	o->de->size = ARG_SIZE;
+
+	ccs_save (o->proc, &s);
+
+	if (!add (o, 0, &s))
+		goto error;
+
+	return o;
+error:
+	ccs_index_free (o);
+	return NULL;
+}
+
+void ccs_index_free (struct ccs_index *o)
+{
+	if (o == NULL)
+		return;
+
+	ccs_free (o->proc);
+	free (o->de);
+	free (o->state);
+	free (o->offset);
+	free (o->index);
+	free (o);
+}
+
+/*
+ * The input is decoded in bulk up to the next checkpoint, then octet by
+ * octet until the sequence being parsed, if any, is finished.
+ */
+int ccs_index_build (struct ccs_index *o, const void *in, size_t len)
+{
+	const unsigned char *p = in;
+	ccs_code_t out[OUT_SIZE];
+	struct ccs_state s;
+	size_t n, count;
+
+	if (o->proc == NULL) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	for (; len > 0; p += n, len -= n, o->pos += n) {
+		if (o->pos < o->next) {
+			n = o->next - o->pos < len ? o->next - o->pos : len;
+			count = OUT_SIZE;
+			n = ccs_decode (o->proc, p, n, out, &count, o->de);
+		}
+		else if (ccs_core_ground (o->proc->core) && o->proc->need == 0) {
+			ccs_save (o->proc, &s);
+
+			if (!add (o, o->pos, &s))
+				return 0;
+
+			o->next = o->pos + o->step;
+			n = 0;
+		}
+		else {
+			ccs_process (o->proc, *p, o->de);
+			n = 1;
+		}
+	}
+
+	return 1;
+}
+
+static void put_le (unsigned char *p, uint64_t x, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; ++i, x >>= 8)
+		p[i] = x;
+}
+
+static uint64_t get_le (const unsigned char *p, size_t size)
+{
+	uint64_t x = 0;
+
+	while (size > 0)
+		x = x << 8 | p[--size];
+
+	return x;
+}
+
+static int put (const unsigned char *data, size_t size, FILE *f)
+{
+	return fwrite (data, size, 1, f) == 1;
+}
+
+static int put_header (const struct header *h, FILE *f)
+{
+	unsigned char b[HEADER_SIZE];
+
+	memcpy (b, h->magic, sizeof (h->magic));
+	put_le (b +  4, h->version,  2);
+	put_le (b +  6, h->reserved, 2);
+	put_le (b +  8, h->states,   4);
+	put_le (b + 12, h->count,    4);
+	put_le (b + 16, h->step,     8);
+	return put (b, sizeof (b), f);
+}
+
+static int put_state_entry (const struct state *o, FILE *f)
+{
+	unsigned char b[STATE_SIZE];
+	size_t i;
+
+	for (i = 0; i < 6; ++i)
+		put_le (b + i * 4, o->set[i], 4);
+
+	b[24] = o->gl;
+	b[25] = o->gr;
+	b[26] = o->ss;
+	b[27] = o->irr;
+	put_le (b + 28, o->lead, 2);
+	b[30] = o->utf8;
+	b[31] = o->reserved;
+	return put (b, sizeof (b), f);
+}
+
+const char *ccs_index_save (const struct ccs_index *o, FILE *f)
+{
+	struct header h;
+	unsigned char b[8];
+	size_t i;
+
+	memset (&h, 0, sizeof (h));
+	memcpy (h.magic, INDEX_MAGIC, sizeof (h.magic));
+
+	h.version = INDEX_VERSION;
+	h.states  = o->states;
+	h.count   = o->count;
+	h.step    = o->step;
+
+	if (!put_header (&h, f))
+		return strerror (errno);
+
+	for (i = 0; i < o->states; ++i)
+		if (!put_state_entry (o->state + i, f))
+			return strerror (errno);
+
+	for (i = 0; i < o->count; ++i) {
+		put_le (b, o->offset[i], 8);
+
+		if (!put (b, 8, f))
+			return strerror (errno);
+	}
+
+	for (i = 0; i < o->count; ++i) {
+		put_le (b, o->index[i], 4);
+
+		if (!put (b, 4, f))
+			return strerror (errno);
+	}
+
+	return fflush (f) == 0 ? NULL : strerror (errno);
+}
+
+static int get (unsigned char *data, size_t size, FILE *f)
+{
+	return fread (data, size, 1, f) == 1;
+}
+
+static int get_header (struct header *h, FILE *f)
+{
+	unsigned char b[HEADER_SIZE];
+
+	if (!get (b, sizeof (b), f))
+		return 0;
+
+	memcpy (h->magic, b, sizeof (h->magic));
+	h->version  = get_le (b +  4, 2);
+	h->reserved = get_le (b +  6, 2);
+	h->states   = get_le (b +  8, 4);
+	h->count    = get_le (b + 12, 4);
+	h->step     = get_le (b + 16, 8);
+	return 1;
+}
+
+static int get_state_entry (struct state *o, FILE *f)
+{
+	unsigned char b[STATE_SIZE];
+	size_t i;
+
+	if (!get (b, sizeof (b), f))
+		return 0;
+
+	memset (o, 0, sizeof (*o));
+
+	for (i = 0; i < 6; ++i)
+		o->set[i] = get_le (b + i * 4, 4);
+
+	o->gl   = b[24];
+	o->gr   = b[25];
+	o->ss   = b[26];
+	o->irr  = b[27];
+	o->lead = get_le (b + 28, 2);
+	o->utf8 = b[30];
+	return 1;
+}
+
+static int get_tables (struct ccs_index *o, FILE *f)
+{
+	unsigned char b[8];
+	size_t i;
+
+	for (i = 0; i < o->states; ++i)
+		if (!get_state_entry (o->state + i, f))
+			return 0;
+
+	for (i = 0; i < o->count; ++i) {
+		if (!get (b, 8, f))
+			return 0;
+
+		o->offset[i] = get_le (b, 8);
+	}
+
+	for (i = 0; i < o->count; ++i) {
+		if (!get (b, 4, f))
+			return 0;
+
+		o->index[i] = get_le (b, 4);
+	}
+
+	return 1;
+}
+
+static int check_index (const struct ccs_index *o)
+{
+	size_t i;
+
+	if (o->offset[0] != 0)
+		return 0;
+
+	for (i = 0; i < o->count; ++i)
+		if (o->index[i] >= o->states ||
+		    (i > 0 && o->offset[i] < o->offset[i - 1]))
+			return 0;
+
+	return 1;
+}
+
+struct ccs_index *ccs_index_load (FILE *f)
+{
+	struct header h;
+	struct ccs_index *o;
+
+	if (!get_header (&h, f))
+		goto no_header;
+
+	if (memcmp (h.magic, INDEX_MAGIC, sizeof (h.magic)) != 0 ||
+	    h.version != INDEX_VERSION || h.step == 0 || h.count == 0 ||
+	    h.states == 0 || h.states > h.count ||
+	    (uint64_t) h.count * sizeof (o->offset[0]) > SIZE_MAX) {
+		errno = EPROTO;
+		return NULL;
+	}
+
+	if ((o = index_alloc (h.step)) == NULL)
+		return NULL;
+
+	o->states = o->states_size = h.states;
+	o->count  = o->size = h.count;
+
+	if ((o->state  = malloc (h.states * sizeof (o->state[0])))  == NULL ||
+	    (o->offset = malloc (h.count  * sizeof (o->offset[0]))) == NULL ||
+	    (o->index  = malloc (h.count  * sizeof (o->index[0])))  == NULL)
+		goto error;
+
+	if (!get_tables (o, f))
+		goto no_data;
+
+	if (!check_index (o)) {
+		errno = EPROTO;
+		goto error;
+	}
+
+	return o;
+no_data:
+	ccs_index_free (o);
+no_header:
+	if (!ferror (f))
+		errno = EPROTO;  /* unexpected end of file */
+
+	return NULL;
+error:
+	ccs_index_free (o);
+	return NULL;
+}
+
+/*
+ * Restores the state of the last checkpoint at or before the offset given
+ * and stores the offset of checkpoint. The stream mode of processor and its
+ * display width flags mode are kept.
+ */
+int ccs_index_seek (const struct ccs_index *o, struct ccs *p,
+		    unsigned long long *offset)
+{
+	size_t lo = 0, hi = o->count, mid;
+	struct ccs_state s;
+
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+
+		if (o->offset[mid] <= *offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	get_state (o->state + o->index[lo], &s);
+	s.stream = p->core->stream;
+	s.width  = p->map->width;
+
+	if (!ccs_restore (p, &s))
+		return 0;
+
+	*offset = o->offset[lo];
+	return 1;
+}
@@ -0,0 +1,89 @@
+/*
+ * Coded Character Set Table Lookup Kernel
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <limits.h>
+
+#include "ccs-lut.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__)) && \
+    UINT_MAX == 0xffffffff
+#define LUT_X86  1
+#include <immintrin.h>
+#endif
+
+static void map_scalar (const ccs_code_t *lut, const unsigned char *in,
+			size_t len, ccs_code_t *out)
+{
+	size_t i;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		out[i + 0] = lut[in[i + 0]];
+		out[i + 1] = lut[in[i + 1]];
+		out[i + 2] = lut[in[i + 2]];
+		out[i + 3] = lut[in[i + 3]];
+	}
+
+	for (; i < len; ++i)
+		out[i] = lut[in[i]];
+}
+
+#ifdef LUT_X86
+
+/*
+ * Eight octets are widened to 32-bit indexes and the codes are gathered
+ * from the table in one instruction.
+ */
+__attribute__ ((target ("avx2")))
+static void map_avx2 (const ccs_code_t *lut, const unsigned char *in,
+		      size_t len, ccs_code_t *out)
+{
+	const int *base = (const int *) lut;
+	size_t i;
+	__m128i x;
+	__m256i a, b;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128 ((const __m128i *) (in + i));
+		a = _mm256_cvtepu8_epi32 (x);
+		b = _mm256_cvtepu8_epi32 (_mm_srli_si128 (x, 8));
+		a = _mm256_i32gather_epi32 (base, a, 4);
+		b = _mm256_i32gather_epi32 (base, b, 4);
+		_mm256_storeu_si256 ((__m256i *) (out + i), a);
+		_mm256_storeu_si256 ((__m256i *) (out + i + 8), b);
+	}
+
+	map_scalar (lut, in + i, len - i, out + i);
+}
+
+static void (*map) (const ccs_code_t *lut, const unsigned char *in,
+		    size_t len, ccs_code_t *out) = map_scalar;
+
+__attribute__ ((constructor))
+static void lut_init (void)
+{
+	__builtin_cpu_init ();
+
+	if (__builtin_cpu_supports ("avx2"))
+		map = map_avx2;
+}
+
+void ccs_lut_map (const ccs_code_t *lut, const unsigned char *in, size_t len,
+		  ccs_code_t *out)
+{
+	map (lut, in, len, out);
+}
+
+#else  /* not LUT_X86 */
+
+void ccs_lut_map (const ccs_code_t *lut, const unsigned char *in, size_t len,
+		  ccs_code_t *out)
+{
+	map_scalar (lut, in, len, out);
+}
+
+#endif  /* LUT_X86 */
@@ -0,0 +1,22 @@
+/*
+ * Coded Character Set Table Lookup Kernel
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_LUT_H
+#define CCS_LUT_H  1
+
+#include <stddef.h>
+
+#include <ccs-types.h>
+
+/*
+ * Translates octets through the table of 256 codes: out[i] = lut[in[i]].
+ */
+void ccs_lut_map (const ccs_code_t *lut, const unsigned char *in, size_t len,
+		  ccs_code_t *out);
+
+#endif  /* CCS_LUT_H */
@@ -0,0 +1,74 @@
+/*
+ * Coded Character Set Character Mapping Internals
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_MAP_IMPL_H
+#define CCS_MAP_IMPL_H  1
+
+#include <stddef.h>
+
+#include <ccs-map.h>
+
+#include "ccs-width.h"
+
+/*
+ * Null character set stands for the identity mapping. The single shift
+ * and the first octet of multiple-byte character are stored increased by
+ * one, zero means none.
+ *
+ * The table of codes for all octets is rebuilt on designation and locking
+ * shift, thus octets are mapped with one load while no single shift or
+ * multiple-byte character is pending. Octets of windows with multiple-byte
+ * set invoked are mapped on slow path.
+ *
+ * While display width flags are enabled, the width planes of graphic sets
+ * are kept along with the sets, and the flags are merged into the table of
+ * codes, thus they cost no extra lookup on fast path.
+ */
+#define CCS_MAP_SLOW	((ccs_code_t) -1)
+
+struct ccs_map {
+	struct ccs_charset *cs[2], *gs[4];
+	unsigned char gl, gr;	/* sets invoked and locked into GL and GR */
+	unsigned char ss;	/* set invoked for a next one character	*/
+	unsigned char direct;	/* table mapped: 1 — GL, 2 — GR; 4 — GL
+				   is mapped to itself			*/
+	unsigned short lead;	/* row of multiple-byte character	*/
+	unsigned char width;	/* display width flags enabled		*/
+	const unsigned char *plane[4];	/* width planes of G0 — G3 sets	*/
+	ccs_code_t lut[256];
+};
+
+/*
+ * Returns non-zero if each octet from GL window is mapped to character
+ * independently: no single shift or multiple-byte character is pending
+ * and the set invoked into GL is single-byte one.
+ */
+static inline int ccs_map_gl_direct (const struct ccs_map *o)
+{
+	return (o->ss | o->lead) == 0 && (o->direct & 1) != 0;
+}
+
+/*
+ * Returns non-zero if each octet from GL window is mapped to itself and
+ * no single shift or multiple-byte character is pending.
+ */
+static inline int ccs_map_gl_ascii (const struct ccs_map *o)
+{
+	return (o->ss | o->lead) == 0 && (o->direct & 4) != 0;
+}
+
+/*
+ * Maps a run of octets from GL window (including SP and DEL), which should
+ * be mapped directly, into the output array. Octets that have no mapping
+ * are discarded. Returns the number of characters stored.
+ */
+size_t ccs_map_gl_run (const struct ccs_map *o, const unsigned char *in,
+		       size_t len, ccs_code_t *out);
+
+#endif  /* CCS_MAP_IMPL_H */
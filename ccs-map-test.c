@@ -0,0 +1,183 @@
+/*
+ * Coded Character Set Character Mapping Test
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccs-map.h>
+
+#define BLOCK_SIZE	(1 << 20)
+#define ASCII_SET	"iso-ir-006"
+
+/*
+ * Display width flags are enabled before designation if width is 1, and
+ * after designation if width is 2: both ways should give the same table.
+ */
+static struct ccs_map *make_map (int argc, char *argv[], int width)
+{
+	struct ccs_map *o;
+	struct ccs_charset *s;
+	int i, ok;
+
+	if ((o = ccs_map_alloc ()) == NULL)
+		return NULL;
+
+	if (width == 1 && !ccs_map_set_width (o, 1))
+		goto no_width;
+
+	for (i = 0; i < argc; ++i) {
+		if ((s = ccs_charset_alloc (argv[i])) == NULL) {
+			perror (argv[i]);
+			goto error;
+		}
+
+		ok = ccs_map_load_gs (o, i, s);
+		ccs_charset_free (s);
+
+		if (!ok) {
+			perror (argv[i]);
+			goto error;
+		}
+	}
+
+	if (width == 2 && !ccs_map_set_width (o, 1))
+		goto no_width;
+
+	return o;
+no_width:
+	perror ("E: cannot enable width flags");
+error:
+	ccs_map_free (o);
+	return NULL;
+}
+
+static void by_code (struct ccs_map *o, const unsigned char *in, size_t len,
+		     ccs_code_t *out)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		out[i] = ccs_map_process (o, in[i]);
+}
+
+/*
+ * Maps the input per code and by block with the sets given, the results
+ * should be the same.
+ */
+static int check (int argc, char *argv[], int width, const unsigned char *in,
+		  ccs_code_t *x, ccs_code_t *y)
+{
+	struct ccs_map *a, *b;
+	int ok;
+
+	if ((a = make_map (argc, argv, width)) == NULL)
+		return 0;
+
+	if ((b = make_map (argc, argv, width * 2)) == NULL) {
+		ccs_map_free (a);
+		return 0;
+	}
+
+	by_code (a, in, BLOCK_SIZE, x);
+	ccs_map_process_block (b, in, BLOCK_SIZE, y);
+
+	if (!(ok = memcmp (x, y, BLOCK_SIZE * sizeof (x[0])) == 0))
+		fprintf (stderr, "E: block and code mapping differ with %s "
+				 "in G0\n", argv[0]);
+
+	ccs_map_free (a);
+	ccs_map_free (b);
+	return ok;
+}
+
+int main (int argc, char *argv[])
+{
+	int rounds = 0, width = 0, i;
+	struct ccs_map *a, *b;
+	char *ascii[2];
+	unsigned char *in;
+	ccs_code_t *x, *y;
+	unsigned long seed = 1;
+	size_t j;
+	clock_t start;
+	double t1, t2;
+
+	if (argc > 3 && strcmp (argv[1], "-n") == 0) {
+		rounds = atoi (argv[2]);
+		argc -= 2, argv += 2;
+	}
+
+	if (argc > 2 && strcmp (argv[1], "-w") == 0) {
+		width = 1;
+		--argc, ++argv;
+	}
+
+	if (argc < 2 || argc > 3) {
+		fprintf (stderr, "usage:\n\tccs-map-test [-n <rounds>] [-w] "
+				 "<g0-set> [<g1-set>]\n");
+		return 1;
+	}
+
+	in = malloc (BLOCK_SIZE);
+	x  = malloc (BLOCK_SIZE * sizeof (x[0]));
+	y  = malloc (BLOCK_SIZE * sizeof (y[0]));
+
+	if (in == NULL || x == NULL || y == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 1;
+	}
+
+	for (j = 0; j < BLOCK_SIZE; ++j) {
+		seed = seed * 1103515245 + 12345;
+		in[j] = seed >> 16;
+	}
+
+	/*
+	 * ASCII in G0 is mapped to itself, the last set given is checked
+	 * against it in G1: thus both the identity and the table paths of
+	 * block mapping are taken.
+	 */
+	ascii[0] = ASCII_SET;
+	ascii[1] = argv[argc - 1];
+
+	if (!check (argc - 1, argv + 1, width, in, x, y) ||
+	    !check (2, ascii, width, in, x, y))
+		return 1;
+
+	if (rounds > 0) {
+		if ((a = make_map (argc - 1, argv + 1, width)) == NULL ||
+		    (b = make_map (argc - 1, argv + 1, width * 2)) == NULL)
+			return 1;
+
+		start = clock ();
+
+		for (i = 0; i < rounds; ++i)
+			by_code (a, in, BLOCK_SIZE, x);
+
+		t1 = (double) (clock () - start) / CLOCKS_PER_SEC;
+		start = clock ();
+
+		for (i = 0; i < rounds; ++i)
+			ccs_map_process_block (b, in, BLOCK_SIZE, y);
+
+		t2 = (double) (clock () - start) / CLOCKS_PER_SEC;
+
+		printf ("code:  %8.2f MB/s\n", BLOCK_SIZE * rounds / t1 / 1e6);
+		printf ("block: %8.2f MB/s\n", BLOCK_SIZE * rounds / t2 / 1e6);
+
+		ccs_map_free (a);
+		ccs_map_free (b);
+	}
+
+	free (in);
+	free (x);
+	free (y);
+	return 0;
+}
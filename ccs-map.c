@@ -0,0 +1,396 @@
+/*
+ * Coded Character Set Character Mapping
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <ccs-control.h>
+
+#include "ccs-lut.h"
+#include "ccs-map-impl.h"
+
+/*
+ * Windows of the table of codes to rebuild
+ */
+#define WIN_CL	1
+#define WIN_GL	2
+#define WIN_CR	4
+#define WIN_GR	8
+#define WIN_ALL	(WIN_CL | WIN_GL | WIN_CR | WIN_GR)
+
+static void update (struct ccs_map *o, int win);
+
+size_t ccs_map_size (void)
+{
+	return sizeof (struct ccs_map);
+}
+
+struct ccs_map *ccs_map_init (void *buf, size_t size)
+{
+	struct ccs_map *o = buf;
+	size_t i;
+
+	if (size < sizeof (*o)) {
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	for (i = 0; i < 2; ++i)
+		o->cs[i] = NULL;
+
+	for (i = 0; i < 4; ++i) {
+		o->gs[i]    = NULL;
+		o->plane[i] = NULL;
+	}
+
+	o->gl    = 0;
+	o->gr    = 1;
+	o->ss    = 0;
+	o->lead  = 0;
+	o->width = 0;
+
+	update (o, WIN_ALL);
+	return o;
+}
+
+void ccs_map_fini (struct ccs_map *o)
+{
+	size_t i;
+
+	for (i = 0; i < 2; ++i)
+		ccs_charset_free (o->cs[i]);
+
+	for (i = 0; i < 4; ++i)
+		ccs_charset_free (o->gs[i]);
+}
+
+struct ccs_map *ccs_map_alloc (void)
+{
+	struct ccs_map *o;
+
+	if ((o = malloc (sizeof (*o))) == NULL)
+		return NULL;
+
+	return ccs_map_init (o, sizeof (*o));
+}
+
+void ccs_map_free (struct ccs_map *o)
+{
+	if (o == NULL)
+		return;
+
+	ccs_map_fini (o);
+	free (o);
+}
+
+static int invalid (void)
+{
+	errno = EINVAL;
+	return 0;
+}
+
+/*
+ * Returns zero if the same set is designated already
+ */
+static int load (struct ccs_charset **slot, struct ccs_charset *s)
+{
+	if (*slot == s)
+		return 0;
+
+	if (s != NULL)
+		ccs_charset_hold (s);
+
+	ccs_charset_free (*slot);
+	*slot = s;
+	return 1;
+}
+
+int ccs_map_load_cs (struct ccs_map *o, int i, struct ccs_charset *s)
+{
+	if (i < 0 || i > 1 ||
+	    (s != NULL && (s->row == NULL || s->order != 1)))
+		return invalid ();
+
+	if (load (o->cs + i, s))
+		update (o, i == 0 ? WIN_CL : WIN_CR);
+
+	return 1;
+}
+
+int ccs_map_load_gs (struct ccs_map *o, int i, struct ccs_charset *s)
+{
+	const unsigned char *plane = NULL;
+
+	if (i < 0 || i > 3 ||
+	    (s != NULL && (s->row == NULL || s->order > 2)))
+		return invalid ();
+
+	if (o->width && s != NULL && (plane = ccs_charset_width (s)) == NULL)
+		return 0;
+
+	if (load (o->gs + i, s)) {
+		o->plane[i] = plane;
+		update (o, (i == o->gl ? WIN_GL : 0) |
+			   (i == o->gr ? WIN_GR : 0));
+	}
+
+	o->lead = 0;
+	return 1;
+}
+
+int ccs_map_lock_gl (struct ccs_map *o, int i)
+{
+	if (i < 0 || i > 3)
+		return invalid ();
+
+	if (o->gl != i) {
+		o->gl = i;
+		update (o, WIN_GL);
+	}
+
+	return 1;
+}
+
+int ccs_map_lock_gr (struct ccs_map *o, int i)
+{
+	if (i < 1 || i > 3)
+		return invalid ();
+
+	if (o->gr != i) {
+		o->gr = i;
+		update (o, WIN_GR);
+	}
+
+	return 1;
+}
+
+int ccs_map_shift_gl (struct ccs_map *o, int i)
+{
+	if (i < 0 || i > 3)
+		return invalid ();
+
+	o->ss = i + 1;
+	return 1;
+}
+
+/*
+ * Width planes are built for all graphic sets designated before the flags
+ * are enabled, thus the map is left unchanged on error.
+ */
+int ccs_map_set_width (struct ccs_map *o, int on)
+{
+	const unsigned char *plane[4] = { NULL };
+	size_t i;
+
+	for (i = 0; i < 4; ++i)
+		if (on && o->gs[i] != NULL &&
+		    (plane[i] = ccs_charset_width (o->gs[i])) == NULL)
+			return 0;
+
+	for (i = 0; i < 4; ++i)
+		o->plane[i] = plane[i];
+
+	o->width = on != 0;
+	update (o, WIN_GL | WIN_GR);
+	return 1;
+}
+
+/*
+ * Returns display width flags of the character from graphic set
+ */
+static ccs_code_t
+map_width (const struct ccs_map *o, unsigned i, unsigned row, unsigned col)
+{
+	const unsigned char *w = o->plane[i];
+
+	return w == NULL ? 0 : ccs_width_get (o->gs[i], w, row, col);
+}
+
+/*
+ * Maps octet via single-byte set without state change
+ */
+static ccs_code_t
+map_single (const struct ccs_charset *s, unsigned x, ccs_code_t c)
+{
+	unsigned i;
+
+	if (s == NULL)
+		return c;
+
+	return (i = x - s->shift) < s->size ? ccs_charset_get (s, 0, i) : 0;
+}
+
+/*
+ * Maps a graphic character: x is the octet value from GL or GR window
+ * with the most significant bit cleared.
+ */
+static ccs_code_t
+map_graphic (struct ccs_map *o, unsigned set, unsigned x, ccs_code_t c)
+{
+	const struct ccs_charset *s = o->gs[set];
+	unsigned i, row;
+
+	if (s == NULL)
+		goto done;
+
+	if ((i = x - s->shift) >= s->size) {
+		c = 0;
+		goto done;
+	}
+
+	if (s->order == 1) {
+		c = ccs_charset_get (s, 0, i) | map_width (o, set, 0, i);
+		goto done;
+	}
+
+	if (o->lead == 0) {
+		o->lead = i + 1;
+		return 0;
+	}
+
+	row = o->lead - 1;
+	c = ccs_charset_get (s, row, i) | map_width (o, set, row, i);
+done:
+	o->lead = 0;
+	o->ss   = 0;
+	return c;
+}
+
+static ccs_code_t map_code (struct ccs_map *o, ccs_code_t c)
+{
+	if (c < 0x20) {
+		o->lead = 0;
+		return map_single (o->cs[0], c, c);
+	}
+
+	if (c == CCS_SP || c == CCS_DEL)
+		return c;
+
+	if (c < 0x80)
+		return map_graphic (o, o->ss ? o->ss - 1 : o->gl, c, c);
+
+	if (c < 0xa0) {
+		o->lead = 0;
+		return map_single (o->cs[1], c - 0x80, c);
+	}
+
+	if (c <= 0xff)
+		return map_graphic (o, o->ss ? o->ss - 1 : o->gr, c & 0x7f, c);
+
+	return c;
+}
+
+ccs_code_t ccs_map_process (struct ccs_map *o, ccs_code_t c)
+{
+	ccs_code_t code;
+
+	if (c <= 0xff && (o->ss | o->lead) == 0 &&
+	    (code = o->lut[c]) != CCS_MAP_SLOW)
+		return code;
+
+	return map_code (o, c);
+}
+
+static int is_single (const struct ccs_charset *s)
+{
+	return s == NULL || s->order == 1;
+}
+
+/*
+ * Maps octet via single-byte graphic set with display width flags, if any
+ */
+static ccs_code_t
+map_gs (const struct ccs_map *o, unsigned set, unsigned x, ccs_code_t c)
+{
+	const struct ccs_charset *s = o->gs[set];
+	unsigned i;
+
+	if (s == NULL || (i = x - s->shift) >= s->size)
+		return map_single (s, x, c);
+
+	return ccs_charset_get (s, 0, i) | map_width (o, set, 0, i);
+}
+
+/*
+ * Returns non-zero if octets from GL window are mapped to the same codes
+ */
+static int is_identity (const struct ccs_map *o)
+{
+	unsigned c;
+
+	for (c = 0x21; c < 0x7f; ++c)
+		if (o->lut[c] != c)
+			return 0;
+
+	return 1;
+}
+
+/*
+ * Rebuilds the specified windows of the table of codes for the current
+ * invocation. Octets from windows with multiple-byte set invoked are
+ * marked to take slow path.
+ */
+static void update (struct ccs_map *o, int win)
+{
+	const struct ccs_charset *gl = o->gs[o->gl], *gr = o->gs[o->gr];
+	unsigned c;
+
+	if ((win & WIN_CL) != 0)
+		for (c = 0; c < 0x20; ++c)
+			o->lut[c] = map_single (o->cs[0], c, c);
+
+	if ((win & WIN_GL) != 0)
+		for (c = 0x21; c < 0x7f; ++c)
+			o->lut[c] = is_single (gl) ? map_gs (o, o->gl, c, c) :
+						     CCS_MAP_SLOW;
+
+	if ((win & WIN_CR) != 0)
+		for (c = 0x80; c < 0xa0; ++c)
+			o->lut[c] = map_single (o->cs[1], c - 0x80, c);
+
+	if ((win & WIN_GR) != 0)
+		for (c = 0xa0; c < 0x100; ++c)
+			o->lut[c] = is_single (gr) ?
+				    map_gs (o, o->gr, c & 0x7f, c) :
+				    CCS_MAP_SLOW;
+
+	o->lut[CCS_SP]  = CCS_SP;
+	o->lut[CCS_DEL] = CCS_DEL;
+
+	o->direct = is_single (gl) | is_single (gr) << 1 |
+		    (is_single (gl) && is_identity (o)) << 2;
+}
+
+void ccs_map_process_block (struct ccs_map *o, const unsigned char *in,
+			    size_t len, ccs_code_t *out)
+{
+	size_t i;
+
+	for (i = 0; i < len &&
+		    ((o->ss | o->lead) != 0 || (o->direct & 3) != 3); ++i)
+		out[i] = ccs_map_process (o, in[i]);
+
+	if (i < len)
+		ccs_lut_map (o->lut, in + i, len - i, out + i);
+}
+
+size_t ccs_map_gl_run (const struct ccs_map *o, const unsigned char *in,
+		       size_t len, ccs_code_t *out)
+{
+	size_t i, n;
+	ccs_code_t code;
+
+	for (i = 0, n = 0; i < len; ++i) {
+		code = o->lut[in[i]];
+		out[n] = code;
+		n += code != 0;
+	}
+
+	return n;
+}
@@ -0,0 +1,165 @@
+/*
+ * Coded Character Set Parallel Decoder Test
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccs-parallel.h>
+
+#include "ccs-test-file.h"
+
+#define ARG_SIZE	64
+#define CHUNK_SIZE	1000	/* small chunks to catch state errors	*/
+#define THREADS		4
+
+static int show (void *cookie, const struct ccs_de *de)
+{
+	FILE *to = cookie;
+	size_t i;
+
+	if (to == NULL)
+		return 0;
+
+	if (de->code == CCS_TEXT)
+		for (i = 0; i < de->len; ++i)
+			fprintf (to, "%08lx\n", (unsigned long) de->text[i]);
+	else if (de->len == 0)
+		fprintf (to, "%08lx\n", (unsigned long) de->code);
+	else
+		fprintf (to, "%08lx %.*s\n", (unsigned long) de->code,
+			 (int) de->len, de->data);
+
+	return 0;
+}
+
+static int by_serial (const unsigned char *p, size_t len, FILE *to)
+{
+	struct ccs *o;
+	struct ccs_de *de;
+	size_t i, n;
+
+	if ((de = malloc (sizeof (*de) + ARG_SIZE)) == NULL)
+		return 0;
+
+	if ((o = ccs_alloc ()) == NULL) {
+		free (de);
+		return 0;
+	}
+
+	de->size = ARG_SIZE;
+
+	for (i = 0; i < len; i += n) {
+		n = len - i;
+
+		if (ccs_next (o, p + i, &n, de))
+			show (to, de);
+	}
+
+	ccs_free (o);
+	free (de);
+	return 1;
+}
+
+static int by_parallel (const unsigned char *p, size_t len, FILE *to,
+			unsigned threads, size_t chunk)
+{
+	struct ccs_parallel_conf conf = { threads, chunk, ARG_SIZE };
+
+	return ccs_decode_parallel (p, len, &conf, show, to);
+}
+
+static int compare (const unsigned char *p, size_t len)
+{
+	char *a = NULL, *b = NULL;
+	size_t alen, blen;
+	FILE *fa, *fb;
+	int ok;
+
+	if ((fa = open_memstream (&a, &alen)) == NULL ||
+	    (fb = open_memstream (&b, &blen)) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 0;
+	}
+
+	ok = by_serial (p, len, fa) &
+	     by_parallel (p, len, fb, THREADS, CHUNK_SIZE);
+
+	fclose (fa);
+	fclose (fb);
+
+	if (!ok)
+		perror ("E: cannot decode");
+	else if (alen != blen || memcmp (a, b, alen) != 0) {
+		fprintf (stderr, "E: parallel and serial decoding differ\n");
+		ok = 0;
+	}
+
+	free (a);
+	free (b);
+	return ok;
+}
+
+/*
+ * Wall time is measured, since the parallel decoder uses several threads
+ */
+static double get_time (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char *argv[])
+{
+	int rounds = 0, ok = 1, i;
+	unsigned char *p;
+	size_t len;
+	double start, a, b;
+
+	if (argc > 3 && strcmp (argv[1], "-n") == 0) {
+		rounds = atoi (argv[2]);
+		argc -= 2, argv += 2;
+	}
+
+	if (argc != 2) {
+		fprintf (stderr, "usage:\n\tccs-parallel-test [-n <rounds>] "
+				 "<file>\n");
+		return 1;
+	}
+
+	if ((p = read_file (argv[1], &len)) == NULL) {
+		perror (argv[1]);
+		return 1;
+	}
+
+	if (rounds == 0)
+		ok = compare (p, len);
+	else {
+		start = get_time ();
+
+		for (i = 0; i < rounds; ++i)
+			by_serial (p, len, NULL);
+
+		a = get_time () - start;
+		start = get_time ();
+
+		for (i = 0; i < rounds; ++i)
+			by_parallel (p, len, NULL, 0, 0);
+
+		b = get_time () - start;
+
+		printf ("serial:   %8.2f MB/s\n", len * rounds / a / 1e6);
+		printf ("parallel: %8.2f MB/s\n", len * rounds / b / 1e6);
+	}
+
+	free (p);
+	return ok ? 0 : 1;
+}
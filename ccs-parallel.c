@@ -0,0 +1,457 @@
+/*
+ * Coded Character Set Parallel Decoder
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ccs-parallel.h>
+
+#define CHUNK_SIZE	(1 << 20)
+#define CHUNK_ALIGN	4096	/* how far to look for LF to end chunk	*/
+#define ARG_SIZE	256
+#define WINDOW		2	/* chunks decoded ahead per thread	*/
+
+/*
+ * The input is split into chunks ended after LF where possible, since
+ * the state is usually reset to the initial one at the end of line. Each
+ * chunk is decoded by worker speculatively from the initial state, and
+ * data elements produced are logged. The chunks are passed to the caller
+ * in order: if the state after the previous chunk differs from the initial
+ * one, the chunk is decoded again from that state.
+ *
+ * Log record consists of the code and the argument length, followed by
+ * the decoded parameters of control sequence, then the characters of text
+ * run or the argument terminated with NUL.
+ */
+struct record {
+	ccs_code_t code;
+	ccs_size_t len;
+};
+
+#define ALIGN(n)	(((n) + sizeof (ccs_code_t) - 1) & \
+			 ~(sizeof (ccs_code_t) - 1))
+
+struct chunk {
+	const unsigned char *in;
+	size_t len;
+	unsigned char *log;
+	size_t used, size;	/* log length and log buffer size	*/
+	struct ccs_state end;	/* state after the chunk		*/
+	struct ccs_de *de;	/* data element after the chunk		*/
+	int done, ok;
+};
+
+struct job {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct chunk *chunk;
+	size_t count;
+	size_t next;		/* the next chunk to decode		*/
+	size_t limit;		/* chunks below limit can be decoded	*/
+	int stop;
+	ccs_size_t size;	/* argument buffer size			*/
+	struct ccs_state initial;
+};
+
+static int has_param (ccs_code_t code)
+{
+	return code >= 0xf0000000;  /* control sequence */
+}
+
+static size_t record_size (const struct ccs_de *de)
+{
+	size_t n = ALIGN (sizeof (struct record));
+
+	if (has_param (de->code))
+		n += ALIGN (sizeof (de->param));
+
+	return n + ALIGN (de->code == CCS_TEXT ?
+			  de->len * sizeof (de->text[0]) : de->len + 1u);
+}
+
+static int grow (struct chunk *c, size_t n)
+{
+	size_t size = c->size == 0 ? c->len * sizeof (ccs_code_t) : c->size;
+	unsigned char *p;
+
+	while (size < c->used + n)
+		size *= 2;
+
+	if ((p = realloc (c->log, size)) == NULL)
+		return 0;
+
+	c->log  = p;
+	c->size = size;
+	return 1;
+}
+
+static int put (struct chunk *c, const struct ccs_de *de)
+{
+	size_t n = record_size (de);
+	unsigned char *p;
+	struct record *r;
+
+	if (c->used + n > c->size && !grow (c, n))
+		return 0;
+
+	p = c->log + c->used;
+	r = (void *) p;
+	r->code = de->code;
+	r->len  = de->len;
+	p += ALIGN (sizeof (*r));
+
+	if (has_param (de->code)) {
+		memcpy (p, &de->param, sizeof (de->param));
+		p += ALIGN (sizeof (de->param));
+	}
+
+	if (de->code == CCS_TEXT)
+		memcpy (p, de->text, de->len * sizeof (de->text[0]));
+	else {
+		if (de->len > 0)
+			memcpy (p, de->data, de->len);
+
+		p[de->len] = '\0';
+	}
+
+	c->used += n;
+	return 1;
+}
+
+/*
+ * Passes the data elements logged to the caller, returns zero if the
+ * caller stops processing.
+ */
+static int
+play (const struct chunk *c, struct ccs_de *de, ccs_output_fn *fn, void *cookie)
+{
+	const unsigned char *p = c->log, *end = p + c->used;
+	const struct record *r;
+
+	while (p < end) {
+		r = (const void *) p;
+		p += ALIGN (sizeof (*r));
+
+		de->code = r->code;
+		de->len  = r->len;
+
+		if (has_param (r->code)) {
+			memcpy (&de->param, p, sizeof (de->param));
+			p += ALIGN (sizeof (de->param));
+		}
+
+		if (r->code == CCS_TEXT) {
+			de->text = (const void *) p;
+			p += ALIGN (r->len * sizeof (de->text[0]));
+		}
+		else {
+			de->data = p;
+			p += ALIGN (r->len + 1u);
+		}
+
+		if (fn (cookie, de) != 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Decodes the chunk from the state given and the data element left after
+ * the previous chunk, if any. The processor is constructed in buf.
+ */
+static int decode (const struct job *j, struct chunk *c,
+		   const struct ccs_state *s, const struct ccs_de *from,
+		   void *buf)
+{
+	size_t de_size = sizeof (*c->de) + j->size, i, n;
+	struct ccs *o;
+
+	if (c->de == NULL && (c->de = malloc (de_size)) == NULL)
+		return 0;
+
+	if (from != NULL) {
+		memcpy (c->de, from, de_size);
+		c->de->data = c->de->arg;  /* argument collected so far */
+	}
+	else {
+		c->de->size = j->size;
+		c->de->len  = 0;
+	}
+
+	if ((o = ccs_init (buf, ccs_size ())) == NULL)
+		return 0;
+
+	if (!ccs_restore (o, s))
+		goto error;
+
+	for (c->used = 0, i = 0; i < c->len; i += n) {
+		n = c->len - i;
+
+		if (ccs_next (o, c->in + i, &n, c->de) && !put (c, c->de))
+			goto error;
+	}
+
+	ccs_save (o, &c->end);
+	ccs_fini (o);
+	return 1;
+error:
+	ccs_fini (o);
+	return 0;
+}
+
+static void *worker (void *cookie)
+{
+	struct job *j = cookie;
+	void *buf = malloc (ccs_size ());
+	struct chunk *c;
+	int ok;
+
+	pthread_mutex_lock (&j->lock);
+
+	for (;;) {
+		while (!j->stop && j->next < j->count && j->next >= j->limit)
+			pthread_cond_wait (&j->cond, &j->lock);
+
+		if (j->stop || j->next >= j->count)
+			break;
+
+		c = j->chunk + j->next++;
+		pthread_mutex_unlock (&j->lock);
+
+		ok = buf != NULL && decode (j, c, &j->initial, NULL, buf);
+
+		pthread_mutex_lock (&j->lock);
+		c->ok   = ok;
+		c->done = 1;
+		pthread_cond_broadcast (&j->cond);
+	}
+
+	pthread_mutex_unlock (&j->lock);
+	free (buf);
+	return NULL;
+}
+
+static int split (struct job *j, const unsigned char *in, size_t len,
+		  size_t chunk)
+{
+	const unsigned char *p, *end = in + len, *lf;
+	size_t i, left, n, tail;
+
+	if ((j->chunk = calloc (len / chunk + 1, sizeof (j->chunk[0]))) == NULL)
+		return 0;
+
+	for (i = 0, p = in; p < end; ++i, p += n) {
+		left = (size_t) (end - p);
+		n    = left < chunk ? left : chunk;
+		tail = left - n < CHUNK_ALIGN ? left - n : CHUNK_ALIGN;
+
+		if ((lf = memchr (p + n, '\n', tail)) != NULL)
+			n = lf + 1 - p;
+
+		j->chunk[i].in  = p;
+		j->chunk[i].len = n;
+	}
+
+	j->count = i;
+	return 1;
+}
+
+static unsigned get_threads (const struct ccs_parallel_conf *conf)
+{
+	long n;
+
+	if (conf != NULL && conf->threads != 0)
+		return conf->threads;
+
+	return (n = sysconf (_SC_NPROCESSORS_ONLN)) > 0 ? n : 1;
+}
+
+/*
+ * Waits for the chunk decoded by worker, returns non-zero if the chunk
+ * is not taken by any worker and should be decoded by caller.
+ */
+static int wait_chunk (struct job *j, size_t i)
+{
+	int own;
+
+	pthread_mutex_lock (&j->lock);
+
+	if ((own = j->next == i))
+		++j->next;
+	else
+		while (!j->chunk[i].done)
+			pthread_cond_wait (&j->cond, &j->lock);
+
+	pthread_mutex_unlock (&j->lock);
+	return own;
+}
+
+static void set_limit (struct job *j, size_t limit, int stop)
+{
+	pthread_mutex_lock (&j->lock);
+
+	j->limit = limit;
+	j->stop  = stop;
+	pthread_cond_broadcast (&j->cond);
+
+	pthread_mutex_unlock (&j->lock);
+}
+
+/*
+ * Passes the chunks to the caller in order, decoding them again from the
+ * actual state if the speculation failed.
+ */
+static int emit (struct job *j, size_t window, void *buf,
+		 ccs_output_fn *fn, void *cookie)
+{
+	struct ccs_state state = j->initial;
+	const struct ccs_de *prev = NULL;
+	struct ccs_de de;
+	struct chunk *c;
+	size_t i;
+
+	de.size = 0;  /* arguments are referenced in log */
+
+	for (i = 0; i < j->count; ++i) {
+		c = j->chunk + i;
+
+		if ((wait_chunk (j, i) || !c->ok ||
+		     memcmp (&state, &j->initial, sizeof (state)) != 0) &&
+		    !decode (j, c, &state, prev, buf))
+			return 0;
+
+		if (!play (c, &de, fn, cookie)) {
+			errno = ECANCELED;
+			return 0;
+		}
+
+		state = c->end;
+		prev  = c->de;
+
+		free (c->log);
+		c->log = NULL;
+
+		if (i > 0) {
+			free (c[-1].de);
+			c[-1].de = NULL;
+		}
+
+		set_limit (j, i + 1 + window, 0);
+	}
+
+	return 1;
+}
+
+/*
+ * Decodes the input in the caller thread with no speculation and logging
+ */
+static int serial (const unsigned char *in, size_t len, ccs_size_t size,
+		   ccs_output_fn *fn, void *cookie)
+{
+	struct ccs *o;
+	struct ccs_de *de;
+	size_t i, n;
+	int ok = 0;
+
+	if ((o = ccs_alloc ()) == NULL)
+		return 0;
+
+	if ((de = malloc (sizeof (*de) + size)) == NULL)
+		goto no_de;
+
+	de->size = size;
+
+	for (i = 0; i < len; i += n) {
+		n = len - i;
+
+		if (ccs_next (o, in + i, &n, de) && fn (cookie, de) != 0) {
+			errno = ECANCELED;
+			goto stop;
+		}
+	}
+
+	ok = 1;
+stop:
+	free (de);
+no_de:
+	ccs_free (o);
+	return ok;
+}
+
+int ccs_decode_parallel (const void *in, size_t len,
+			 const struct ccs_parallel_conf *conf,
+			 ccs_output_fn *fn, void *cookie)
+{
+	unsigned threads = get_threads (conf), started = 0;
+	size_t chunk = conf != NULL && conf->chunk != 0 ? conf->chunk :
+							  CHUNK_SIZE;
+	struct job j;
+	pthread_t *tid;
+	void *buf;
+	struct ccs *o;
+	size_t i;
+	int ok = 0;
+
+	j.size = conf != NULL && conf->size != 0 ? conf->size : ARG_SIZE;
+
+	if (threads < 2 || len <= chunk)
+		return serial (in, len, j.size, fn, cookie);
+
+	if (!split (&j, in, len, chunk))
+		return 0;
+
+	if ((tid = malloc (threads * sizeof (tid[0]))) == NULL)
+		goto no_tid;
+
+	if ((buf = malloc (ccs_size ())) == NULL)
+		goto no_buf;
+
+	if ((o = ccs_init (buf, ccs_size ())) == NULL)
+		goto no_init;
+
+	ccs_save (o, &j.initial);
+	ccs_fini (o);
+
+	pthread_mutex_init (&j.lock, NULL);
+	pthread_cond_init (&j.cond, NULL);
+
+	j.next  = 0;
+	j.limit = threads * WINDOW;
+	j.stop  = 0;
+
+	/* the caller thread decodes too */
+	for (; started + 1 < threads; ++started)
+		if (pthread_create (tid + started, NULL, worker, &j) != 0)
+			break;
+
+	ok = emit (&j, threads * WINDOW, buf, fn, cookie);
+	set_limit (&j, j.count, 1);
+
+	for (i = 0; i < started; ++i)
+		pthread_join (tid[i], NULL);
+
+	pthread_cond_destroy (&j.cond);
+	pthread_mutex_destroy (&j.lock);
+no_init:
+	free (buf);
+no_buf:
+	free (tid);
+no_tid:
+	for (i = 0; i < j.count; ++i) {
+		free (j.chunk[i].log);
+		free (j.chunk[i].de);
+	}
+
+	free (j.chunk);
+	return ok;
+}
@@ -0,0 +1,20 @@
+/*
+ * Coded Character Set Cache Pool Internals
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_POOL_IMPL_H
+#define CCS_POOL_IMPL_H  1
+
+#include <ccs-pool.h>
+
+/*
+ * Returns the cached character set by designation key, see ccs_charset_key.
+ */
+struct ccs_charset *ccs_pool_get_key (struct ccs_pool *o, unsigned long key);
+
+#endif  /* CCS_POOL_IMPL_H */
@@ -0,0 +1,153 @@
+/*
+ * Coded Character Set Cache Pool Test
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ccs-pool.h>
+
+#define THREADS	4
+#define ROUNDS	10000
+#define UNKNOWN	300	/* more than slots in the pool			*/
+
+struct job {
+	struct ccs_pool *pool;
+	const struct ccs_de *de;
+	struct ccs_charset *set;
+	int ok;
+};
+
+static void *worker (void *cookie)
+{
+	struct job *o = cookie;
+	struct ccs_charset *set;
+	int i;
+
+	for (o->ok = 1, i = 0; i < ROUNDS; ++i) {
+		set = ccs_pool_get_charset (o->pool, o->de);
+
+		if (set != o->set)
+			o->ok = 0;
+
+		ccs_charset_free (set);
+	}
+
+	return NULL;
+}
+
+/*
+ * Designation is given as escape sequence without ESC, for example, "(B"
+ * for ASCII or "$B@" for JIS X 0208-1990 (the last byte is revision).
+ */
+static int test (struct ccs_pool *pool, const char *seq)
+{
+	struct {
+		struct ccs_de de;
+		unsigned char arg[8];
+	} e;
+	struct job job[THREADS];
+	pthread_t tid[THREADS];
+	struct ccs_charset *set;
+	int i, ok;
+
+	e.de.code = 0xc0000000 | (unsigned char) seq[0];
+	e.de.size = sizeof (e.arg);
+	e.de.len  = strlen (seq + 1);
+
+	memcpy (e.de.arg, seq + 1, e.de.len < e.de.size ? e.de.len : e.de.size);
+
+	if ((set = ccs_pool_get_charset (pool, &e.de)) == NULL) {
+		printf ("%s: %s\n", seq, strerror (errno));
+		return errno == ENOENT;
+	}
+
+	for (i = 0; i < THREADS; ++i) {
+		job[i].pool = pool;
+		job[i].de   = &e.de;
+		job[i].set  = set;
+
+		pthread_create (tid + i, NULL, worker, job + i);
+	}
+
+	for (ok = 1, i = 0; i < THREADS; ++i) {
+		pthread_join (tid[i], NULL);
+		ok &= job[i].ok;
+	}
+
+	ccs_charset_free (set);
+	printf ("%s: %s\n", seq, ok ? "ok" : "failed");
+	return ok;
+}
+
+/*
+ * Unknown designations are cached too, a stream full of them should not
+ * lock the known character sets out of the pool. The designations used
+ * are 94- and 96-character sets with intermediate byte and private final
+ * byte, none of them is registered.
+ */
+static void flood (struct ccs_pool *pool)
+{
+	struct {
+		struct ccs_de de;
+		unsigned char arg[8];
+	} e;
+	struct ccs_charset *set;
+	int i;
+
+	for (i = 0; i < UNKNOWN; ++i) {
+		e.de.code   = 0xc0000000 | (i % 2 == 0 ? '(' : '-');
+		e.de.size   = sizeof (e.arg);
+		e.de.len    = 2;
+		e.de.arg[0] = 0x21 + i / 2 / 16;
+		e.de.arg[1] = 0x30 + i / 2 % 16;
+
+		if ((set = ccs_pool_get_charset (pool, &e.de)) != NULL)
+			ccs_charset_free (set);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	struct ccs_pool *pool;
+	size_t limit = 0;
+	int i, ok;
+	struct ccs_pool_stats st;
+
+	if (argc > 2 && strcmp (argv[1], "-l") == 0) {
+		limit = atol (argv[2]);
+		argc -= 2, argv += 2;
+	}
+
+	if (argc < 2) {
+		fprintf (stderr, "usage:\n\tccs-pool-test [-l <limit>] "
+				 "<designation> ...\n");
+		return 1;
+	}
+
+	if ((pool = ccs_pool_alloc ()) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 1;
+	}
+
+	ccs_pool_set_limit (pool, limit);
+
+	flood (pool);
+
+	for (ok = 1, i = 1; i < argc; ++i)
+		ok &= test (pool, argv[i]);
+
+	ccs_pool_get_stats (pool, &st);
+	printf ("bytes %zu, limit %zu, hits %lu, misses %lu, evictions %lu\n",
+		st.bytes, st.limit, st.hits, st.misses, st.evictions);
+
+	ccs_pool_free (pool);
+	return ok ? 0 : 1;
+}
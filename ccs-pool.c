@@ -0,0 +1,543 @@
+/*
+ * Coded Character Set Cache Pool
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <ccs-pool.h>
+
+#include "ccs-charset-impl.h"
+#include "ccs-pool-impl.h"
+
+/*
+ * The pool is an open addressing hash table keyed by designation. Slots
+ * are changed under the pool lock only: the character set is stored first,
+ * then the key is published. Null character set caches unknown designation,
+ * such slots hold no memory and the least recently used one is reused when
+ * the table is full.
+ *
+ * Lookups are lock-free. To take a reference to the character set reader
+ * pins the slot by its user counter and checks the key again. To evict a
+ * character set the key is replaced with a tombstone first, then evictor
+ * waits for all slot users gone. Thus, a pinned slot with the matching key
+ * always refers to the valid character set.
+ */
+#define POOL_ORDER	8
+#define POOL_SIZE	(1 << POOL_ORDER)
+
+#define KEY_EMPTY	0
+#define KEY_DELETED	(~0ul)
+
+/*
+ * The memory held by cached sets is tracked per slot. Parent tables shared
+ * by several sets are counted once: they are kept in the table of parents
+ * with the number of cached sets inheriting them. The reverse index and the
+ * width plane are built on first use, the lazy field records which of them
+ * were counted already.
+ */
+#define LAZY_RINDEX	1
+#define LAZY_WIDTH	2
+
+struct slot {
+	atomic_ulong key;
+	atomic_uint users;
+	atomic_ulong used;	/* last use time stamp			*/
+	struct ccs_charset *set;
+	size_t bytes;		/* memory held by the set		*/
+	unsigned lazy;		/* lazy structures counted		*/
+};
+
+struct parent {
+	const struct ccs_charset *set;
+	size_t count;		/* number of cached sets inheriting it	*/
+	size_t bytes;
+	unsigned lazy;
+};
+
+struct ccs_pool {
+	pthread_mutex_t lock;
+	size_t bytes, limit;
+	atomic_ulong hits;	/* also serves as a clock for LRU	*/
+	unsigned long misses, evictions;
+	struct parent *parent;
+	size_t parents, parents_size;
+	struct slot slot[POOL_SIZE];
+};
+
+struct ccs_pool *ccs_pool_alloc (void)
+{
+	struct ccs_pool *o;
+	size_t i;
+
+	if ((o = malloc (sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((errno = pthread_mutex_init (&o->lock, NULL)) != 0)
+		goto no_lock;
+
+	o->bytes     = 0;
+	o->limit     = 0;
+	o->misses    = 0;
+	o->evictions = 0;
+	o->parent    = NULL;
+	o->parents   = o->parents_size = 0;
+
+	atomic_init (&o->hits, 0);
+
+	for (i = 0; i < POOL_SIZE; ++i) {
+		atomic_init (&o->slot[i].key, KEY_EMPTY);
+		atomic_init (&o->slot[i].users, 0);
+		atomic_init (&o->slot[i].used, 0);
+		o->slot[i].set   = NULL;
+		o->slot[i].bytes = 0;
+		o->slot[i].lazy  = 0;
+	}
+
+	return o;
+no_lock:
+	free (o);
+	return NULL;
+}
+
+void ccs_pool_free (struct ccs_pool *o)
+{
+	size_t i;
+
+	if (o == NULL)
+		return;
+
+	for (i = 0; i < POOL_SIZE; ++i)
+		ccs_charset_free (o->slot[i].set);
+
+	free (o->parent);
+	pthread_mutex_destroy (&o->lock);
+	free (o);
+}
+
+/*
+ * The default pool is shared by all processors and encoders of the process
+ * and lives until the process exit.
+ */
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+static struct ccs_pool *default_pool;
+
+static void default_init (void)
+{
+	default_pool = ccs_pool_alloc ();
+}
+
+struct ccs_pool *ccs_pool_default (void)
+{
+	if (pthread_once (&default_once, default_init) != 0) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (default_pool == NULL)
+		errno = ENOMEM;
+
+	return default_pool;
+}
+
+static size_t get_hash (unsigned long key)
+{
+	return ((key * 0x9e3779b1ul) & 0xffffffff) >> (32 - POOL_ORDER);
+}
+
+/*
+ * Returns the slot with the specified key or NULL if key is not found.
+ */
+static struct slot *lookup (struct ccs_pool *o, unsigned long key)
+{
+	size_t i, h;
+	struct slot *s;
+	unsigned long k;
+
+	for (i = 0, h = get_hash (key); i < POOL_SIZE; ++i, ++h) {
+		s = o->slot + (h & (POOL_SIZE - 1));
+		k = atomic_load_explicit (&s->key, memory_order_acquire);
+
+		if (k == key)
+			return s;
+
+		if (k == KEY_EMPTY)
+			break;
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns the first free slot in the probe sequence for the specified key
+ * or NULL if pool is full. Called with the pool lock held.
+ */
+static struct slot *lookup_free (struct ccs_pool *o, unsigned long key)
+{
+	size_t i, h;
+	struct slot *s;
+	unsigned long k;
+
+	for (i = 0, h = get_hash (key); i < POOL_SIZE; ++i, ++h) {
+		s = o->slot + (h & (POOL_SIZE - 1));
+		k = atomic_load_explicit (&s->key, memory_order_relaxed);
+
+		if (k == KEY_EMPTY || k == KEY_DELETED)
+			return s;
+	}
+
+	return NULL;
+}
+
+static struct ccs_charset *get_set (struct slot *s, unsigned long stamp)
+{
+	atomic_store_explicit (&s->used, stamp, memory_order_relaxed);
+
+	if (s->set == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	return ccs_charset_hold (s->set);
+}
+
+/*
+ * Tries to get the cached character set without locking. Returns non-zero
+ * on cache hit.
+ */
+static int
+get_cached (struct ccs_pool *o, unsigned long key, struct ccs_charset **set)
+{
+	struct slot *s;
+	unsigned long stamp;
+
+	if ((s = lookup (o, key)) == NULL)
+		return 0;
+
+	atomic_fetch_add (&s->users, 1);
+
+	if (atomic_load (&s->key) != key) {  /* evicted concurrently */
+		atomic_fetch_sub (&s->users, 1);
+		return 0;
+	}
+
+	stamp = atomic_fetch_add_explicit (&o->hits, 1, memory_order_relaxed);
+	*set = get_set (s, stamp);
+
+	atomic_fetch_sub_explicit (&s->users, 1, memory_order_release);
+	return 1;
+}
+
+static unsigned get_lazy (const struct ccs_charset *s)
+{
+	return (atomic_load (&s->rindex) != NULL ? LAZY_RINDEX : 0) |
+	       (atomic_load (&s->width)  != NULL ? LAZY_WIDTH  : 0);
+}
+
+static struct parent *
+find_parent (struct ccs_pool *o, const struct ccs_charset *set)
+{
+	size_t i;
+
+	for (i = 0; i < o->parents; ++i)
+		if (o->parent[i].set == set)
+			return o->parent + i;
+
+	return NULL;
+}
+
+/*
+ * Makes room in the table of parents for all the parents of the set, thus
+ * adding them cannot fail. Called with the pool lock held.
+ */
+static int reserve_parents (struct ccs_pool *o, const struct ccs_charset *set)
+{
+	size_t size = o->parents;
+	struct parent *p;
+
+	for (set = set->parent; set != NULL; set = set->parent)
+		++size;
+
+	if (size <= o->parents_size)
+		return 1;
+
+	size = size < 16 ? 16 : size * 2;
+
+	if ((p = realloc (o->parent, size * sizeof (*p))) == NULL)
+		return 0;
+
+	o->parent = p;
+	o->parents_size = size;
+	return 1;
+}
+
+/*
+ * Counts the memory of the set stored into slot and of its parents not
+ * inherited by other cached sets yet. Called with the pool lock held.
+ */
+static void add_bytes (struct ccs_pool *o, struct slot *s)
+{
+	const struct ccs_charset *set;
+	struct parent *p;
+
+	s->lazy  = get_lazy (s->set);
+	s->bytes = ccs_charset_memsize (s->set);
+	o->bytes += s->bytes;
+
+	for (set = s->set->parent; set != NULL; set = set->parent) {
+		if ((p = find_parent (o, set)) == NULL) {
+			p = o->parent + o->parents++;
+			p->set   = set;
+			p->count = 0;
+			p->lazy  = get_lazy (set);
+			p->bytes = ccs_charset_memsize (set);
+			o->bytes += p->bytes;
+		}
+
+		++p->count;
+	}
+}
+
+/*
+ * Drops the memory of the set stored in slot and of its parents no more
+ * inherited by other cached sets. Called with the pool lock held.
+ */
+static void sub_bytes (struct ccs_pool *o, struct slot *s)
+{
+	const struct ccs_charset *set;
+	struct parent *p;
+
+	o->bytes -= s->bytes;
+	s->bytes = 0;
+
+	for (set = s->set->parent; set != NULL; set = set->parent) {
+		p = find_parent (o, set);
+
+		if (--p->count > 0)
+			continue;
+
+		o->bytes -= p->bytes;
+		*p = o->parent[--o->parents];
+	}
+}
+
+/*
+ * Recounts the memory of sets and parents whose reverse index or width
+ * plane has been built since they were counted. Called with the pool lock
+ * held.
+ */
+static void refresh_bytes (struct ccs_pool *o)
+{
+	struct slot *s;
+	struct parent *p;
+	size_t i;
+
+	for (i = 0; i < POOL_SIZE; ++i) {
+		s = o->slot + i;
+
+		if (s->set == NULL || get_lazy (s->set) == s->lazy)
+			continue;
+
+		o->bytes -= s->bytes;
+		s->lazy  = get_lazy (s->set);
+		s->bytes = ccs_charset_memsize (s->set);
+		o->bytes += s->bytes;
+	}
+
+	for (i = 0; i < o->parents; ++i) {
+		p = o->parent + i;
+
+		if (get_lazy (p->set) == p->lazy)
+			continue;
+
+		o->bytes -= p->bytes;
+		p->lazy  = get_lazy (p->set);
+		p->bytes = ccs_charset_memsize (p->set);
+		o->bytes += p->bytes;
+	}
+}
+
+/*
+ * Evicts the character set from slot if it is not used by anyone except
+ * the pool. Called with the pool lock held.
+ */
+static int evict (struct ccs_pool *o, struct slot *s)
+{
+	unsigned long key = atomic_load_explicit (&s->key,
+						  memory_order_relaxed);
+
+	atomic_store (&s->key, KEY_DELETED);
+
+	while (atomic_load (&s->users) != 0)
+		sched_yield ();
+
+	if (atomic_load (&s->set->refs) != 1) {  /* referenced meanwhile */
+		atomic_store_explicit (&s->key, key, memory_order_release);
+		return 0;
+	}
+
+	sub_bytes (o, s);
+	ccs_charset_free (s->set);
+	s->set = NULL;
+
+	++o->evictions;
+	return 1;
+}
+
+/*
+ * Frees the least recently used slot caching unknown designation to make
+ * room for a new key. Returns NULL if there is no such slot. Called with
+ * the pool lock held.
+ */
+static struct slot *reuse_unknown (struct ccs_pool *o)
+{
+	size_t i;
+	struct slot *s, *victim;
+	unsigned long k;
+
+	for (victim = NULL, i = 0; i < POOL_SIZE; ++i) {
+		s = o->slot + i;
+		k = atomic_load_explicit (&s->key, memory_order_relaxed);
+
+		if (k == KEY_EMPTY || k == KEY_DELETED || s->set != NULL)
+			continue;
+
+		if (victim == NULL ||
+		    atomic_load (&s->used) < atomic_load (&victim->used))
+			victim = s;
+	}
+
+	if (victim == NULL)
+		return NULL;
+
+	atomic_store (&victim->key, KEY_DELETED);
+
+	while (atomic_load (&victim->users) != 0)
+		sched_yield ();
+
+	++o->evictions;
+	return victim;
+}
+
+/*
+ * Evicts least recently used character sets not referenced by anyone
+ * except the pool until the memory limit is satisfied. Called with
+ * the pool lock held.
+ */
+static void shrink (struct ccs_pool *o)
+{
+	size_t i;
+	struct slot *s, *victim;
+	unsigned long k;
+
+	refresh_bytes (o);
+
+	while (o->limit != 0 && o->bytes > o->limit) {
+		for (victim = NULL, i = 0; i < POOL_SIZE; ++i) {
+			s = o->slot + i;
+			k = atomic_load_explicit (&s->key,
+						  memory_order_relaxed);
+
+			if (k == KEY_EMPTY || k == KEY_DELETED ||
+			    s->set == NULL ||
+			    atomic_load (&s->set->refs) != 1)
+				continue;
+
+			if (victim == NULL ||
+			    atomic_load (&s->used) < atomic_load (&victim->used))
+				victim = s;
+		}
+
+		if (victim == NULL || !evict (o, victim))
+			break;
+	}
+}
+
+struct ccs_charset *ccs_pool_get_key (struct ccs_pool *o, unsigned long key)
+{
+	struct slot *s;
+	struct ccs_charset *set;
+
+	if (key == 0) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	if (get_cached (o, key, &set))
+		return set;
+
+	pthread_mutex_lock (&o->lock);
+
+	if (get_cached (o, key, &set))  /* loaded concurrently */
+		goto out;
+
+	++o->misses;
+
+	if ((set = ccs_charset_locate_key (key)) == NULL && errno != ENOENT)
+		goto out;
+
+	if (set != NULL && !reserve_parents (o, set))
+		goto out;  /* passed to caller uncached */
+
+	if ((s = lookup_free (o, key)) == NULL &&
+	    (s = reuse_unknown (o)) == NULL)  /* pool is full */
+		goto out;
+
+	s->set = set;
+
+	if (set != NULL)
+		add_bytes (o, s);
+
+	atomic_store_explicit (&s->used, atomic_load (&o->hits),
+			       memory_order_relaxed);
+	atomic_store_explicit (&s->key, key, memory_order_release);
+
+	if (set == NULL)
+		errno = ENOENT;
+	else
+		ccs_charset_hold (set);
+
+	shrink (o);
+out:
+	pthread_mutex_unlock (&o->lock);
+	return set;
+}
+
+struct ccs_charset *
+ccs_pool_get_charset (struct ccs_pool *o, const struct ccs_de *de)
+{
+	return ccs_pool_get_key (o, ccs_charset_key (de));
+}
+
+void ccs_pool_set_limit (struct ccs_pool *o, size_t limit)
+{
+	pthread_mutex_lock (&o->lock);
+
+	o->limit = limit;
+	shrink (o);
+
+	pthread_mutex_unlock (&o->lock);
+}
+
+void ccs_pool_get_stats (struct ccs_pool *o, struct ccs_pool_stats *s)
+{
+	pthread_mutex_lock (&o->lock);
+
+	refresh_bytes (o);
+
+	s->bytes     = o->bytes;
+	s->limit     = o->limit;
+	s->hits      = atomic_load_explicit (&o->hits, memory_order_relaxed);
+	s->misses    = o->misses;
+	s->evictions = o->evictions;
+
+	pthread_mutex_unlock (&o->lock);
+}
@@ -0,0 +1,84 @@
+/*
+ * Coded Character Set Reverse Index
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ccs-rindex.h"
+
+#define CODE_MAX	0x10ffff
+#define TOP_SIZE	((CODE_MAX >> 8) + 1)
+
+static int is_graphic (ccs_code_t c)
+{
+	return (c > 0x20 && c < 0x7f) || (c >= 0xa0 && c <= CODE_MAX);
+}
+
+/*
+ * The first pass assigns pages to used top entries, the second one fills
+ * the cells of allocated block.
+ */
+static void *build (const struct ccs_charset *s)
+{
+	const unsigned rows = s->order == 2 ? s->size : 1;
+	unsigned short *top, (*page)[256];
+	unsigned ntop = 0, npages = 1, r, c, x;
+	size_t size;
+	ccs_code_t code;
+	struct ccs_rindex *o;
+
+	if ((top = calloc (TOP_SIZE, sizeof (top[0]))) == NULL)
+		return NULL;
+
+	for (r = 0; r < rows; ++r)
+		for (c = 0; c < s->size; ++c) {
+			if (!is_graphic (code = ccs_charset_get (s, r, c)) ||
+			    top[code >> 8] != 0)
+				continue;
+
+			top[code >> 8] = npages++;
+
+			if ((code >> 8) >= ntop)
+				ntop = (code >> 8) + 1;
+		}
+
+	size = sizeof (*o) + npages * sizeof (page[0]) + ntop * sizeof (top[0]);
+
+	if ((o = malloc (size)) == NULL)
+		goto no_index;
+
+	page = (void *) (o + 1);
+	memset (page, 0, npages * sizeof (page[0]));
+	memcpy (page + npages, top, ntop * sizeof (top[0]));
+
+	o->size = size;
+	o->ntop = ntop;
+	o->top  = (void *) (page + npages);
+	o->page = page;
+
+	for (r = 0; r < rows; ++r)
+		for (c = 0; c < s->size; ++c) {
+			if (!is_graphic (code = ccs_charset_get (s, r, c)))
+				continue;
+
+			x = s->order == 2 ? (r + s->shift) << 8 | (c + s->shift) :
+					    c + s->shift;
+
+			if (page[top[code >> 8]][code & 0xff] == 0)
+				page[top[code >> 8]][code & 0xff] = x;
+		}
+no_index:
+	free (top);
+	return o;
+}
+
+const struct ccs_rindex *ccs_charset_rindex (struct ccs_charset *o)
+{
+	return ccs_charset_lazy (o, &o->rindex, build);
+}
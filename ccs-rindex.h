@@ -0,0 +1,51 @@
+/*
+ * Coded Character Set Reverse Index
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_RINDEX_H
+#define CCS_RINDEX_H  1
+
+#include "ccs-charset-impl.h"
+
+/*
+ * Reverse index is two-level trie: the top table is indexed by the code
+ * shifted right by eight and refers to a page of 256 cells indexed by the
+ * last octet of code. Unused pages share the page of zeroes. A cell holds
+ * the octets of character in 7-bit form: the column octet for single-byte
+ * sets, the row octet and the column octet for double-byte sets. Zero
+ * means no character. Only codes of graphic characters up to U+10FFFF are
+ * indexed, including Private Use Area. If the same code is present at
+ * several positions, then the first one is indexed.
+ *
+ * The index is allocated as one block and released with the set.
+ */
+struct ccs_rindex {
+	size_t size;		/* memory size of the block		*/
+	unsigned ntop;
+	const unsigned short *top;
+	const unsigned short (*page)[256];
+};
+
+/*
+ * Returns the reverse index of the character set, see ccs_charset_lazy.
+ */
+const struct ccs_rindex *ccs_charset_rindex (struct ccs_charset *o);
+
+/*
+ * Returns the octets of character with the specified code or zero if the
+ * character is not present in the set.
+ */
+static inline
+unsigned ccs_rindex_get (const struct ccs_rindex *o, ccs_code_t c)
+{
+	ccs_code_t hi = c >> 8;
+
+	return hi < o->ntop ? o->page[o->top[hi]][c & 0xff] : 0;
+}
+
+#endif  /* CCS_RINDEX_H */
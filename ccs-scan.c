@@ -0,0 +1,398 @@
+/*
+ * Coded Character Set Octet Run Scanner
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: RFC 3629, The Unicode Standard (Table 3-7)
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ccs-scan.h"
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define SCAN_X86  1
+#include <immintrin.h>
+#endif
+
+/*
+ * Scalar version checks eight octets at once: an octet is from 02/00 to
+ * 07/15 if its most significant bit is clear and adding 06/00 to it sets
+ * that bit. Carries are possible from invalid octets only.
+ */
+#define ONES	0x0101010101010101ull
+#define HIGH	(ONES * 0x80)
+
+static size_t scan_scalar (const unsigned char *p, size_t len)
+{
+	size_t i = 0;
+	uint64_t x;
+
+	for (; i + 8 <= len; i += 8) {
+		memcpy (&x, p + i, sizeof (x));
+
+		if (((x | ~(x + ONES * 0x60)) & HIGH) != 0)
+			break;
+	}
+
+	for (; i < len && p[i] >= 0x20 && p[i] < 0x80; ++i) {}
+
+	return i;
+}
+
+/*
+ * Returns the length of well-formed UTF-8 sequence of character from
+ * U+00A0 on, zero if the sequence is ill-formed, incomplete or it is not
+ * a sequence of such character.
+ */
+static size_t utf8_size (const unsigned char *p, size_t len)
+{
+	unsigned c = p[0], lo = 0x80, hi = 0xbf;
+	size_t n, i;
+
+	if (c < 0xc2 || c > 0xf4)
+		return 0;
+
+	if ((n = c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4) > len)
+		return 0;
+
+	switch (c) {
+	case 0xc2:	lo = 0xa0; break;  /* C1 controls */
+	case 0xe0:	lo = 0xa0; break;
+	case 0xed:	hi = 0x9f; break;  /* surrogates */
+	case 0xf0:	lo = 0x90; break;
+	case 0xf4:	hi = 0x8f; break;
+	}
+
+	if (p[1] < lo || p[1] > hi)
+		return 0;
+
+	for (i = 2; i < n; ++i)
+		if ((p[i] & 0xc0) != 0x80)
+			return 0;
+
+	return n;
+}
+
+static size_t utf8_scalar (const unsigned char *p, size_t len)
+{
+	size_t i = 0, n;
+
+	for (;;) {
+		i += scan_scalar (p + i, len - i);
+
+		if (i == len || (n = utf8_size (p + i, len - i)) == 0)
+			return i;
+
+		i += n;
+	}
+}
+
+#ifdef SCAN_X86
+
+/*
+ * Octets from 02/00 to 07/15 are exactly ones greater than 01/15 when
+ * compared as signed.
+ */
+__attribute__ ((target ("sse2")))
+static size_t scan_sse2 (const unsigned char *p, size_t len)
+{
+	const __m128i low = _mm_set1_epi8 (0x1f);
+	size_t i;
+	__m128i x;
+	unsigned mask;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128 ((const __m128i *) (p + i));
+		mask = ~_mm_movemask_epi8 (_mm_cmpgt_epi8 (x, low)) & 0xffff;
+
+		if (mask != 0)
+			return i + __builtin_ctz (mask);
+	}
+
+	return i + scan_scalar (p + i, len - i);
+}
+
+__attribute__ ((target ("avx2")))
+static size_t scan_avx2 (const unsigned char *p, size_t len)
+{
+	const __m256i low = _mm256_set1_epi8 (0x1f);
+	size_t i;
+	__m256i x;
+	unsigned mask;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		x = _mm256_loadu_si256 ((const __m256i *) (p + i));
+		mask = ~_mm256_movemask_epi8 (_mm256_cmpgt_epi8 (x, low));
+
+		if (mask != 0)
+			return i + __builtin_ctz (mask);
+	}
+
+	return i + scan_sse2 (p + i, len - i);
+}
+
+/*
+ * Vector UTF-8 validator looks up error bits by the high and the low
+ * nibbles of the previous octet and by the high nibble of the octet: an
+ * octet pair is ill-formed if a bit is set in all three. The third and
+ * the fourth octets of sequences are checked against the lead octets two
+ * and three octets back, see J. Keiser, D. Lemire, "Validating UTF-8 In
+ * Less Than One Instruction Per Byte". C0 controls and C1 controls, coded
+ * as C2 80 — C2 9F, end the run as well.
+ */
+#define TOO_SHORT	0x01	/* lead not followed by continuation	*/
+#define TOO_LONG	0x02	/* ASCII followed by continuation	*/
+#define OVERLONG_3	0x04	/* E0 80 — E0 9F			*/
+#define TOO_LARGE	0x08	/* F4 90 — F4 BF, F5 — FF		*/
+#define SURROGATE	0x10	/* ED A0 — ED BF			*/
+#define OVERLONG_2	0x20	/* C0, C1				*/
+#define TOO_LARGE_1000	0x40	/* F5 80 — FF 8F			*/
+#define OVERLONG_4	0x40	/* F0 80 — F0 8F			*/
+#define TWO_CONTS	0x80	/* continuation after continuation	*/
+
+#define CARRY		(TOO_SHORT | TOO_LONG | TWO_CONTS)
+#define LARGE		(CARRY | TOO_LARGE | TOO_LARGE_1000)
+
+static const unsigned char byte_1_high[16] = {
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+	TOO_SHORT | OVERLONG_2,
+	TOO_SHORT,
+	TOO_SHORT | OVERLONG_3 | SURROGATE,
+	TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+static const unsigned char byte_1_low[16] = {
+	CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+	CARRY | OVERLONG_2,
+	CARRY, CARRY,
+	CARRY | TOO_LARGE,
+	LARGE, LARGE, LARGE,
+	LARGE, LARGE, LARGE, LARGE, LARGE,
+	LARGE | SURROGATE,
+	LARGE, LARGE,
+};
+
+static const unsigned char byte_2_high[16] = {
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+	OVERLONG_4,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE  | TOO_LARGE,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+/*
+ * A block ends with an incomplete sequence if any of the last three octets
+ * is greater than the value in the same position.
+ */
+static const unsigned char incomplete[32] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf,
+};
+
+/*
+ * Returns the offset of the last character boundary at or before the end
+ * of the well-formed run given: the last character of run may be
+ * incomplete.
+ */
+static size_t utf8_boundary (const unsigned char *p, size_t len)
+{
+	size_t k, n;
+
+	for (k = 1; k <= 3 && k <= len; ++k) {
+		if (p[len - k] < 0x80)
+			break;
+
+		if (p[len - k] >= 0xc0) {
+			n = p[len - k] < 0xe0 ? 2 : p[len - k] < 0xf0 ? 3 : 4;
+			return n > k ? len - k : len;
+		}
+	}
+
+	return len;
+}
+
+#define LOAD_128(p)	_mm_loadu_si128 ((const __m128i *) (p))
+#define LOAD_256(p)	_mm256_loadu_si256 ((const __m256i *) (p))
+#define SPLAT_256(p)	_mm256_broadcastsi128_si256 (LOAD_128 (p))
+
+__attribute__ ((target ("ssse3")))
+static size_t utf8_ssse3 (const unsigned char *p, size_t len)
+{
+	const __m128i b1h = LOAD_128 (byte_1_high);
+	const __m128i b1l = LOAD_128 (byte_1_low);
+	const __m128i b2h = LOAD_128 (byte_2_high);
+	const __m128i max = LOAD_128 (incomplete + 16);
+	const __m128i low = _mm_set1_epi8 (0x1f), nib = _mm_set1_epi8 (0x0f);
+	const __m128i c2  = _mm_set1_epi8 ((char) 0xc2);
+	const __m128i a0  = _mm_set1_epi8 ((char) 0xa0);
+	const __m128i top = _mm_set1_epi8 ((char) 0x80);
+	const __m128i third  = _mm_set1_epi8 (0xe0 - 0x80);
+	const __m128i fourth = _mm_set1_epi8 (0xf0 - 0x80);
+	const __m128i zero = _mm_setzero_si128 ();
+	__m128i x, prev = zero, tail = zero, p1, p2, p3, h1, l1, h2, e, m;
+	size_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = LOAD_128 (p + i);
+
+		if (_mm_movemask_epi8 (_mm_cmpgt_epi8 (x, low)) == 0xffff) {
+			if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (tail, zero)) !=
+			    0xffff)
+				break;
+
+			prev = x;
+			tail = zero;
+			continue;
+		}
+
+		p1 = _mm_alignr_epi8 (x, prev, 15);
+		p2 = _mm_alignr_epi8 (x, prev, 14);
+		p3 = _mm_alignr_epi8 (x, prev, 13);
+
+		h1 = _mm_and_si128 (_mm_srli_epi16 (p1, 4), nib);
+		l1 = _mm_and_si128 (p1, nib);
+		h2 = _mm_and_si128 (_mm_srli_epi16 (x, 4), nib);
+
+		e = _mm_and_si128 (_mm_shuffle_epi8 (b1h, h1),
+				   _mm_shuffle_epi8 (b1l, l1));
+		e = _mm_and_si128 (e, _mm_shuffle_epi8 (b2h, h2));
+
+		m = _mm_or_si128 (_mm_subs_epu8 (p2, third),
+				  _mm_subs_epu8 (p3, fourth));
+		e = _mm_xor_si128 (e, _mm_and_si128 (m, top));
+
+		m = _mm_and_si128 (_mm_cmpeq_epi8 (p1, c2),
+				   _mm_cmpgt_epi8 (a0, x));
+		e = _mm_or_si128 (e, m);
+
+		m = _mm_min_epu8 (x, low);
+		e = _mm_or_si128 (e, _mm_cmpeq_epi8 (m, x));
+
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (e, zero)) != 0xffff)
+			break;
+
+		prev = x;
+		tail = _mm_subs_epu8 (x, max);
+	}
+
+	i = utf8_boundary (p, i);
+	return i + utf8_scalar (p + i, len - i);
+}
+
+__attribute__ ((target ("avx2")))
+static size_t utf8_avx2 (const unsigned char *p, size_t len)
+{
+	const __m256i b1h = SPLAT_256 (byte_1_high);
+	const __m256i b1l = SPLAT_256 (byte_1_low);
+	const __m256i b2h = SPLAT_256 (byte_2_high);
+	const __m256i max = LOAD_256 (incomplete);
+	const __m256i low = _mm256_set1_epi8 (0x1f);
+	const __m256i nib = _mm256_set1_epi8 (0x0f);
+	const __m256i c2  = _mm256_set1_epi8 ((char) 0xc2);
+	const __m256i a0  = _mm256_set1_epi8 ((char) 0xa0);
+	const __m256i top = _mm256_set1_epi8 ((char) 0x80);
+	const __m256i third  = _mm256_set1_epi8 (0xe0 - 0x80);
+	const __m256i fourth = _mm256_set1_epi8 (0xf0 - 0x80);
+	const __m256i zero = _mm256_setzero_si256 ();
+	__m256i x, prev = zero, tail = zero, s, p1, p2, p3, h1, l1, h2, e, m;
+	size_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		x = LOAD_256 (p + i);
+
+		if (~_mm256_movemask_epi8 (_mm256_cmpgt_epi8 (x, low)) == 0) {
+			if (!_mm256_testz_si256 (tail, tail))
+				break;
+
+			prev = x;
+			tail = zero;
+			continue;
+		}
+
+		s  = _mm256_permute2x128_si256 (prev, x, 0x21);
+		p1 = _mm256_alignr_epi8 (x, s, 15);
+		p2 = _mm256_alignr_epi8 (x, s, 14);
+		p3 = _mm256_alignr_epi8 (x, s, 13);
+
+		h1 = _mm256_and_si256 (_mm256_srli_epi16 (p1, 4), nib);
+		l1 = _mm256_and_si256 (p1, nib);
+		h2 = _mm256_and_si256 (_mm256_srli_epi16 (x, 4), nib);
+
+		e = _mm256_and_si256 (_mm256_shuffle_epi8 (b1h, h1),
+				      _mm256_shuffle_epi8 (b1l, l1));
+		e = _mm256_and_si256 (e, _mm256_shuffle_epi8 (b2h, h2));
+
+		m = _mm256_or_si256 (_mm256_subs_epu8 (p2, third),
+				     _mm256_subs_epu8 (p3, fourth));
+		e = _mm256_xor_si256 (e, _mm256_and_si256 (m, top));
+
+		m = _mm256_and_si256 (_mm256_cmpeq_epi8 (p1, c2),
+				      _mm256_cmpgt_epi8 (a0, x));
+		e = _mm256_or_si256 (e, m);
+
+		m = _mm256_min_epu8 (x, low);
+		e = _mm256_or_si256 (e, _mm256_cmpeq_epi8 (m, x));
+
+		if (!_mm256_testz_si256 (e, e))
+			break;
+
+		prev = x;
+		tail = _mm256_subs_epu8 (x, max);
+	}
+
+	i = utf8_boundary (p, i);
+	return i + utf8_ssse3 (p + i, len - i);
+}
+
+static size_t (*scan) (const unsigned char *p, size_t len) = scan_scalar;
+static size_t (*scan_utf8) (const unsigned char *p, size_t len) = utf8_scalar;
+
+__attribute__ ((constructor))
+static void scan_init (void)
+{
+	__builtin_cpu_init ();
+
+	if (__builtin_cpu_supports ("avx2"))
+		scan = scan_avx2;
+	else if (__builtin_cpu_supports ("sse2"))
+		scan = scan_sse2;
+
+	if (__builtin_cpu_supports ("avx2"))
+		scan_utf8 = utf8_avx2;
+	else if (__builtin_cpu_supports ("ssse3"))
+		scan_utf8 = utf8_ssse3;
+}
+
+size_t ccs_scan_gl (const unsigned char *p, size_t len)
+{
+	return scan (p, len);
+}
+
+size_t ccs_scan_utf8 (const unsigned char *p, size_t len)
+{
+	return scan_utf8 (p, len);
+}
+
+#else  /* not SCAN_X86 */
+
+size_t ccs_scan_gl (const unsigned char *p, size_t len)
+{
+	return scan_scalar (p, len);
+}
+
+size_t ccs_scan_utf8 (const unsigned char *p, size_t len)
+{
+	return utf8_scalar (p, len);
+}
+
+#endif  /* SCAN_X86 */
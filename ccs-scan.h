@@ -0,0 +1,28 @@
+/*
+ * Coded Character Set Octet Run Scanner
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_SCAN_H
+#define CCS_SCAN_H  1
+
+#include <stddef.h>
+
+/*
+ * Returns the length of the leading run of octets from GL window including
+ * SP and DEL, that is octets from 02/00 to 07/15.
+ */
+size_t ccs_scan_gl (const unsigned char *p, size_t len);
+
+/*
+ * Returns the length of the leading run of well-formed UTF-8 sequences of
+ * graphic characters including SP and DEL, that is characters U+0020 —
+ * U+007F and U+00A0 — U+10FFFF except surrogates. The run ends at the
+ * character boundary.
+ */
+size_t ccs_scan_utf8 (const unsigned char *p, size_t len);
+
+#endif  /* CCS_SCAN_H */
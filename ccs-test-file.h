@@ -0,0 +1,50 @@
+/*
+ * Coded Character Set Test File Helper
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_TEST_FILE_H
+#define CCS_TEST_FILE_H  1
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Reads the whole file into the allocated buffer, the length of data read
+ * is stored into len. Returns NULL on error and sets errno.
+ */
+static inline unsigned char *read_file (const char *path, size_t *len)
+{
+	FILE *f;
+	unsigned char *p = NULL, *q;
+	size_t size = 0, n;
+
+	if ((f = fopen (path, "rb")) == NULL)
+		return NULL;
+
+	for (*len = 0; !feof (f); *len += n) {
+		if (*len == size) {
+			size = size == 0 ? 65536 : size * 2;
+
+			if ((q = realloc (p, size)) == NULL)
+				goto no_memory;
+
+			p = q;
+		}
+
+		if ((n = fread (p + *len, 1, size - *len, f)) == 0 && ferror (f))
+			goto no_memory;
+	}
+
+	fclose (f);
+	return p;
+no_memory:
+	free (p);
+	fclose (f);
+	return NULL;
+}
+
+#endif  /* CCS_TEST_FILE_H */
@@ -0,0 +1,556 @@
+/*
+ * Coded Character Set Processor Test
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ccs.h>
+#include <ccs-control.h>
+
+#include "ccs-test-file.h"
+
+#define ARG_SIZE	64
+#define OUT_SIZE	256
+#define CHUNK_SIZE	1000	/* not aligned to catch boundary errors	*/
+#define UTF8_SIZE	1021	/* not aligned to catch boundary errors	*/
+
+static int width;	/* display width flags enabled */
+
+/*
+ * Allocates a processor with display width flags enabled if requested,
+ * that cannot fail while no sets are designated.
+ */
+static struct ccs *make_ccs (void)
+{
+	struct ccs *o;
+
+	if ((o = ccs_alloc ()) != NULL)
+		ccs_set_width (o, width);
+
+	return o;
+}
+
+static void show_code (FILE *to, ccs_code_t code)
+{
+	if (to != NULL)
+		fprintf (to, "%08lx\n", (unsigned long) code);
+}
+
+/*
+ * Shows decoded parameters of control sequence as "[?1;2:3;-]", where an
+ * omitted parameter is shown as "-". Control sequences without parameter
+ * bytes have one omitted parameter and are shown as codes.
+ */
+static void show_param (FILE *to, const struct ccs_param *p)
+{
+	int i;
+
+	fputs (" [", to);
+
+	if (p->mark != 0)
+		fputc (p->mark, to);
+
+	for (i = 0; i < p->count; ++i) {
+		if (i > 0)
+			fputc ((p->sub & (1u << i)) != 0 ? ':' : ';', to);
+
+		if ((p->omit & (1u << i)) != 0)
+			fputc ('-', to);
+		else
+			fprintf (to, "%u", p->value[i]);
+	}
+
+	fputc (']', to);
+}
+
+static void show (FILE *to, const struct ccs_de *de)
+{
+	if (to == NULL)
+		return;
+
+	if (de->len == 0) {
+		show_code (to, de->code);
+		return;
+	}
+
+	fprintf (to, "%08lx %.*s", (unsigned long) de->code, (int) de->len,
+		 de->data);
+
+	if (de->code >= 0xf0000000)
+		show_param (to, &de->param);
+
+	fputc ('\n', to);
+}
+
+static int by_code (const unsigned char *p, size_t len, struct ccs_de *de,
+		    FILE *to)
+{
+	struct ccs *o;
+	size_t i, k;
+
+	if ((o = make_ccs ()) == NULL)
+		return 0;
+
+	for (i = 0; i < len; ++i) {
+		if (!ccs_process (o, p[i], de))
+			continue;
+
+		if (de->code != CCS_TEXT)
+			show (to, de);
+		else
+			for (k = 0; k < de->len; ++k)
+				show_code (to, de->text[k]);
+	}
+
+	ccs_free (o);
+	return 1;
+}
+
+static int by_block (const unsigned char *p, size_t len, struct ccs_de *de,
+		     FILE *to)
+{
+	struct ccs *o;
+	size_t chunk, i, n, count, k;
+	ccs_code_t out[OUT_SIZE];
+
+	if ((o = make_ccs ()) == NULL)
+		return 0;
+
+	for (; len > 0; p += chunk, len -= chunk) {
+		chunk = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+
+		for (i = 0; i < chunk; i += n) {
+			count = OUT_SIZE;
+			n = ccs_decode (o, p + i, chunk - i, out, &count, de);
+
+			for (k = 0; k < count; ++k)
+				show_code (to, out[k]);
+
+			if (de->len > 0)
+				show (to, de);
+		}
+	}
+
+	ccs_free (o);
+	return 1;
+}
+
+static int by_run (const unsigned char *p, size_t len, struct ccs_de *de,
+		   FILE *to)
+{
+	struct ccs *o;
+	size_t chunk, i, n, k;
+
+	if ((o = make_ccs ()) == NULL)
+		return 0;
+
+	for (; len > 0; p += chunk, len -= chunk) {
+		chunk = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+
+		for (i = 0; i < chunk; i += n) {
+			n = chunk - i;
+
+			if (!ccs_next (o, p + i, &n, de))
+				continue;
+
+			if (de->code != CCS_TEXT)
+				show (to, de);
+			else
+				for (k = 0; k < de->len; ++k)
+					show_code (to, de->text[k]);
+		}
+	}
+
+	ccs_free (o);
+	return 1;
+}
+
+/*
+ * Shows characters from the UTF-8 buffer, which is well-formed
+ */
+static void show_utf8 (FILE *to, const unsigned char *p, size_t len)
+{
+	const unsigned char *end = p + len;
+	ccs_code_t c;
+	int n;
+
+	while (p < end) {
+		n = *p < 0x80 ? 0 : *p < 0xe0 ? 1 : *p < 0xf0 ? 2 : 3;
+		c = n == 0 ? *p : *p & (0x3f >> n);
+
+		for (++p; n > 0; --n, ++p)
+			c = c << 6 | (*p & 0x3f);
+
+		show_code (to, c);
+	}
+}
+
+static int by_utf8 (const unsigned char *p, size_t len, struct ccs_de *de,
+		    FILE *to)
+{
+	struct ccs *o;
+	size_t chunk, i, n, size;
+	unsigned char out[UTF8_SIZE];
+	int found;
+
+	if ((o = ccs_alloc ()) == NULL)
+		return 0;
+
+	for (; len > 0; p += chunk, len -= chunk) {
+		chunk = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+
+		for (i = 0; i < chunk; i += n) {
+			n = chunk - i;
+			size = sizeof (out);
+			found = ccs_decode_utf8 (o, p + i, &n, out, &size, de);
+
+			if (to != NULL)
+				show_utf8 (to, out, size);
+
+			if (found)
+				show (to, de);
+		}
+	}
+
+	ccs_free (o);
+	return 1;
+}
+
+/*
+ * The processor is parked after each chunk: its state is saved and the
+ * processor is finalized, then the state is restored into a new one
+ * constructed in the same memory.
+ */
+static int by_park (const unsigned char *p, size_t len, struct ccs_de *de,
+		    FILE *to)
+{
+	void *buf;
+	struct ccs *o;
+	struct ccs_state state;
+	size_t chunk, i, n, count, k;
+	ccs_code_t out[OUT_SIZE];
+	int ok = 0;
+
+	if ((buf = malloc (ccs_size ())) == NULL)
+		return 0;
+
+	if ((o = ccs_init (buf, ccs_size ())) == NULL)
+		goto no_init;
+
+	ccs_set_width (o, width);  /* kept in the state saved */
+
+	for (; len > 0; p += chunk, len -= chunk) {
+		chunk = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+
+		for (i = 0; i < chunk; i += n) {
+			count = OUT_SIZE;
+			n = ccs_decode (o, p + i, chunk - i, out, &count, de);
+
+			for (k = 0; k < count; ++k)
+				show_code (to, out[k]);
+
+			if (de->len > 0)
+				show (to, de);
+		}
+
+		ccs_save (o, &state);
+		ccs_fini (o);
+
+		if ((o = ccs_init (buf, ccs_size ())) == NULL)
+			goto no_init;
+
+		if (!ccs_restore (o, &state)) {
+			perror ("E: cannot restore state");
+			goto no_restore;
+		}
+	}
+
+	ok = 1;
+no_restore:
+	ccs_fini (o);
+no_init:
+	free (buf);
+	return ok;
+}
+
+static int is_string (ccs_code_t code)
+{
+	return code == CCS_DCS || code == CCS_SOS || code == CCS_OSC ||
+	       code == CCS_PM  || code == CCS_APC;
+}
+
+/*
+ * Appends chunk of control string to the assembled one, which is
+ * truncated to the size of its buffer as in non-stream mode.
+ */
+static void append (struct ccs_de *s, const struct ccs_de *de)
+{
+	size_t n = de->len < s->size - s->len ? de->len : s->size - s->len;
+
+	memcpy (s->arg + s->len, de->data, n);
+	s->len += n;
+}
+
+static void show_stream (FILE *to, const struct ccs_de *de, struct ccs_de *s,
+			 int *open)
+{
+	size_t k;
+
+	if (*open && (de->code == CCS_CHUNK || de->code == CCS_ST)) {
+		append (s, de);
+
+		if (de->code == CCS_ST) {
+			s->arg[s->len] = '\0';
+			show (to, s);
+			*open = 0;
+		}
+	}
+	else if (de->len == 0 && is_string (de->code)) {
+		s->code = de->code;
+		s->size = ARG_SIZE;
+		s->len  = 0;
+		s->data = s->arg;
+		*open = 1;
+	}
+	else if (de->code == CCS_TEXT)
+		for (k = 0; k < de->len; ++k)
+			show_code (to, de->text[k]);
+	else
+		show (to, de);
+}
+
+/*
+ * Control strings are passed in chunks and assembled back to be shown
+ * the same way as in non-stream mode.
+ */
+static int by_stream (const unsigned char *p, size_t len, struct ccs_de *de,
+		      FILE *to)
+{
+	struct ccs *o;
+	struct ccs_de *s;
+	size_t chunk, i, n;
+	int open = 0;
+
+	if ((s = malloc (sizeof (*s) + ARG_SIZE + 1)) == NULL)
+		return 0;
+
+	if ((o = make_ccs ()) == NULL) {
+		free (s);
+		return 0;
+	}
+
+	ccs_set_stream (o, 1);
+
+	for (; len > 0; p += chunk, len -= chunk) {
+		chunk = len < CHUNK_SIZE ? len : CHUNK_SIZE;
+
+		for (i = 0; i < chunk; i += n) {
+			n = chunk - i;
+
+			if (ccs_next (o, p + i, &n, de))
+				show_stream (to, de, s, &open);
+		}
+	}
+
+	ccs_free (o);
+	free (s);
+	return 1;
+}
+
+typedef int process_fn (const unsigned char *p, size_t len,
+			struct ccs_de *de, FILE *to);
+
+static double measure (process_fn *fn, const unsigned char *p, size_t len,
+		       struct ccs_de *de, int rounds)
+{
+	clock_t start = clock ();
+	int i;
+
+	for (i = 0; i < rounds; ++i)
+		if (!fn (p, len, de, NULL))
+			return 0;
+
+	return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+/*
+ * Known answers for the parameters of control sequences: the output of
+ * each processing method should match the one given.
+ */
+static const struct known {
+	const char *in, *out;
+} known[] = {
+	{ "\033[38;2;1;2;3m", "f000006d 38;2;1;2;3 [38;2;1;2;3]\n" },
+	{ "\033[4:3m",	     "f000006d 4:3 [4:3]\n" },
+	{ "\033[?25h",	     "f0000068 ?25 [?25]\n" },
+	{ "\033[;5H",	     "f0000048 ;5 [-;5]\n" },
+	{ "\033[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16;17;18m",
+	  "f000006d 1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16;17;18 "
+	  "[1;2;3;4;5;6;7;8;9;10;11;12;13;14;15;16]\n" },
+	{ "\033[70000;1m",	     "f000006d 70000;1 [65535;1]\n" },
+};
+
+static int check_known (struct ccs_de *de)
+{
+	static process_fn *const method[] = {
+		by_code, by_block, by_run, by_park, by_utf8,
+	};
+	const size_t count = sizeof (known) / sizeof (known[0]);
+	const size_t methods = sizeof (method) / sizeof (method[0]);
+	const struct known *k;
+	char *out = NULL;
+	size_t i, j, len;
+	FILE *f;
+	int ok;
+
+	for (i = 0; i < count; ++i)
+		for (k = known + i, j = 0; j < methods; ++j) {
+			if ((f = open_memstream (&out, &len)) == NULL) {
+				fprintf (stderr, "E: no enough memory\n");
+				return 0;
+			}
+
+			ok = method[j] ((const unsigned char *) k->in,
+					strlen (k->in), de, f);
+			fclose (f);
+
+			if (ok && strcmp (out, k->out) != 0) {
+				fprintf (stderr, "E: known answer %zu, method "
+						 "%zu: %s", i, j, out);
+				ok = 0;
+			}
+
+			free (out);
+			out = NULL;
+
+			if (!ok)
+				return 0;
+		}
+
+	return 1;
+}
+
+static int compare (const unsigned char *p, size_t len, struct ccs_de *de)
+{
+	char *a = NULL, *b = NULL, *c = NULL, *d = NULL, *e = NULL, *u = NULL;
+	size_t alen, blen, clen, dlen, elen, ulen;
+	FILE *fa, *fb, *fc, *fd, *fe, *fu;
+	int ok;
+
+	if ((fa = open_memstream (&a, &alen)) == NULL ||
+	    (fb = open_memstream (&b, &blen)) == NULL ||
+	    (fc = open_memstream (&c, &clen)) == NULL ||
+	    (fd = open_memstream (&d, &dlen)) == NULL ||
+	    (fe = open_memstream (&e, &elen)) == NULL ||
+	    (fu = open_memstream (&u, &ulen)) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		return 0;
+	}
+
+	ok = by_code (p, len, de, fa) & by_block (p, len, de, fb) &
+	     by_run (p, len, de, fc) & by_stream (p, len, de, fd) &
+	     by_park (p, len, de, fe) & by_utf8 (p, len, de, fu);
+
+	fclose (fa);
+	fclose (fb);
+	fclose (fc);
+	fclose (fd);
+	fclose (fe);
+	fclose (fu);
+
+	if (!ok)
+		fprintf (stderr, "E: cannot create processor\n");
+	else if (alen != blen || memcmp (a, b, alen) != 0) {
+		fprintf (stderr, "E: block and code processing differ\n");
+		ok = 0;
+	}
+	else if (alen != clen || memcmp (a, c, alen) != 0) {
+		fprintf (stderr, "E: run and code processing differ\n");
+		ok = 0;
+	}
+	else if (alen != dlen || memcmp (a, d, alen) != 0) {
+		fprintf (stderr, "E: stream and code processing differ\n");
+		ok = 0;
+	}
+	else if (alen != elen || memcmp (a, e, alen) != 0) {
+		fprintf (stderr, "E: parked and code processing differ\n");
+		ok = 0;
+	}
+	else if (!width && (alen != ulen || memcmp (a, u, alen) != 0)) {
+		fprintf (stderr, "E: UTF-8 and code processing differ\n");
+		ok = 0;
+	}
+	else
+		fwrite (a, 1, alen, stdout);
+
+	free (a);
+	free (b);
+	free (c);
+	free (d);
+	free (e);
+	free (u);
+	return ok;
+}
+
+int main (int argc, char *argv[])
+{
+	int rounds = 0, ok = 1;
+	unsigned char *p;
+	size_t len;
+	struct ccs_de *de;
+	double a, b, c, d;
+
+	if (argc > 3 && strcmp (argv[1], "-n") == 0) {
+		rounds = atoi (argv[2]);
+		argc -= 2, argv += 2;
+	}
+
+	if (argc > 2 && strcmp (argv[1], "-w") == 0) {
+		width = 1;
+		--argc, ++argv;
+	}
+
+	if (argc != 2) {
+		fprintf (stderr, "usage:\n\tccs-test [-n <rounds>] [-w] "
+				 "<file>\n");
+		return 1;
+	}
+
+	if ((p = read_file (argv[1], &len)) == NULL) {
+		perror (argv[1]);
+		return 1;
+	}
+
+	if ((de = malloc (sizeof (*de) + ARG_SIZE)) == NULL) {
+		fprintf (stderr, "E: no enough memory\n");
+		free (p);
+		return 1;
+	}
+
+	de->size = ARG_SIZE;
+
+	if (rounds == 0)
+		ok = check_known (de) && compare (p, len, de);
+	else {
+		a = measure (by_code,  p, len, de, rounds);
+		b = measure (by_block, p, len, de, rounds);
+		c = measure (by_run,   p, len, de, rounds);
+		d = measure (by_utf8,  p, len, de, rounds);
+
+		printf ("code:  %8.2f MB/s\n", len * rounds / a / 1e6);
+		printf ("block: %8.2f MB/s\n", len * rounds / b / 1e6);
+		printf ("run:   %8.2f MB/s\n", len * rounds / c / 1e6);
+		printf ("utf8:  %8.2f MB/s\n", len * rounds / d / 1e6);
+	}
+
+	free (de);
+	free (p);
+	return ok ? 0 : 1;
+}
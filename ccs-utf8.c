@@ -0,0 +1,207 @@
+/*
+ * Coded Character Set Processor UTF-8 Input and Output
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48, RFC 3629
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <string.h>
+
+#include <ccs-control.h>
+
+#include "ccs-impl.h"
+#include "ccs-scan.h"
+#include "ccs-width.h"
+
+#define UTF8_MAX	4	/* maximum length of UTF-8 sequence	*/
+#define CODE_MAX	0x110000
+
+/*
+ * Stores UTF-8 sequence for the character code, returns its length
+ */
+static size_t put_utf8 (unsigned char *p, ccs_code_t c)
+{
+	if (c < 0x80) {
+		p[0] = c;
+		return 1;
+	}
+
+	if (c < 0x800) {
+		p[0] = 0xc0 | c >> 6;
+		p[1] = 0x80 | (c & 0x3f);
+		return 2;
+	}
+
+	if (c < 0x10000) {
+		p[0] = 0xe0 | c >> 12;
+		p[1] = 0x80 | (c >> 6 & 0x3f);
+		p[2] = 0x80 | (c & 0x3f);
+		return 3;
+	}
+
+	p[0] = 0xf0 | c >> 18;
+	p[1] = 0x80 | (c >> 12 & 0x3f);
+	p[2] = 0x80 | (c >> 6 & 0x3f);
+	p[3] = 0x80 | (c & 0x3f);
+	return 4;
+}
+
+/*
+ * Loads the character code from well-formed UTF-8 sequence, returns its
+ * length
+ */
+static size_t get_utf8 (const unsigned char *p, ccs_code_t *c)
+{
+	if (p[0] < 0x80) {
+		*c = p[0];
+		return 1;
+	}
+
+	if (p[0] < 0xe0) {
+		*c = (p[0] & 0x1f) << 6 | (p[1] & 0x3f);
+		return 2;
+	}
+
+	if (p[0] < 0xf0) {
+		*c = (p[0] & 0x0f) << 12 | (p[1] & 0x3f) << 6 | (p[2] & 0x3f);
+		return 3;
+	}
+
+	*c = (ccs_code_t) (p[0] & 0x07) << 18 | (p[1] & 0x3f) << 12 |
+	     (p[2] & 0x3f) << 6 | (p[3] & 0x3f);
+	return 4;
+}
+
+size_t ccs_utf8_text (const struct ccs *o, const unsigned char *p, size_t len,
+		      ccs_code_t *out, size_t *count)
+{
+	size_t i, n;
+
+	len = ccs_scan_utf8 (p, len < *count ? len : *count);
+
+	for (i = 0, n = 0; i < len; ++n)
+		i += get_utf8 (p + i, out + n);
+
+	if (o->map->width)
+		for (i = 0; i < n; ++i)
+			out[i] |= ccs_code_width (out[i]);
+
+	*count = n;
+	return len;
+}
+
+/*
+ * Returns the code of character without display width flags, codes above
+ * characters are returned as is.
+ */
+static ccs_code_t get_char (ccs_code_t c)
+{
+	return c < 0xc0000000 ? c & ~CCS_WIDTH_MASK : c;
+}
+
+/*
+ * Encodes the run of octets from GL window mapped by table, stops before
+ * an octet mapped to a code which is not a character. Octets that have no
+ * mapping are discarded. Returns the number of octets consumed.
+ */
+static size_t put_gl_run (const struct ccs_map *o, const unsigned char *in,
+			  size_t len, unsigned char **out)
+{
+	size_t i;
+	ccs_code_t c;
+
+	for (i = 0; i < len; ++i) {
+		if ((c = get_char (o->lut[in[i]])) >= CODE_MAX)
+			break;
+
+		if (c != 0)
+			*out += put_utf8 (*out, c);
+	}
+
+	return i;
+}
+
+/*
+ * Returns non-zero if the data element is a character or a control
+ * character to be passed in text: control functions with arguments,
+ * sequences and delimiters of control strings are not.
+ */
+static int is_text (const struct ccs_de *de)
+{
+	switch (de->code) {
+	case CCS_DCS: case CCS_SOS: case CCS_ST:
+	case CCS_OSC: case CCS_PM:  case CCS_APC:
+		return 0;
+	}
+
+	return de->len == 0 && get_char (de->code) < CODE_MAX;
+}
+
+int ccs_decode_utf8 (struct ccs *o, const void *in, size_t *len,
+		     void *out, size_t *size, struct ccs_de *de)
+{
+	const unsigned char *p = in, *end = p + *len;
+	unsigned char *d = out, *stop = d + *size;
+	size_t left, room, run;
+	int found = 0;
+
+	while (p < end && d < stop) {
+		left = (size_t) (end - p);
+		room = (size_t) (stop - d);
+
+		if (ccs_utf8_direct (o)) {
+			run = left < room ? left : room;
+
+			if ((run = ccs_scan_utf8 (p, run)) > 0) {
+				memcpy (d, p, run);
+				p += run;
+				d += run;
+				continue;
+			}
+		}
+		else if (ccs_gl_ascii (o)) {
+			run = left < room ? left : room;
+
+			if ((run = ccs_scan_gl (p, run)) > 0) {
+				memcpy (d, p, run);
+				p += run;
+				d += run;
+				continue;
+			}
+		}
+		else if (ccs_gl_direct (o)) {
+			run = left < room / UTF8_MAX ? left : room / UTF8_MAX;
+
+			if ((run = ccs_scan_gl (p, run)) > 0 &&
+			    (run = put_gl_run (o->map, p, run, &d)) > 0) {
+				p += run;
+				continue;
+			}
+		}
+
+		if ((run = ccs_string_run (o, p, left, de)) > 0) {
+			p += run;
+			continue;
+		}
+
+		if (room < UTF8_MAX)
+			break;
+
+		if (!ccs_process_step (o, &p, de))
+			continue;
+
+		if (!is_text (de)) {
+			found = 1;
+			break;
+		}
+
+		d += put_utf8 (d, get_char (de->code));
+	}
+
+	ccs_core_detach (o->core, de);
+	*len  = p - (const unsigned char *) in;
+	*size = d - (unsigned char *) out;
+	return found;
+}
@@ -0,0 +1,45 @@
+/*
+ * Coded Character Set Display Width
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, UAX #11
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_WIDTH_H
+#define CCS_WIDTH_H  1
+
+#include "ccs-charset-impl.h"
+
+/*
+ * Width plane holds the display width flags of characters in the cells of
+ * character set shifted right by CCS_WIDTH_SHIFT: one octet per cell, rows
+ * follow one after another. Empty cells have no flags.
+ */
+#define CCS_WIDTH_SHIFT	24
+
+/*
+ * Returns the display width flags of character: CCS_WIDE for East Asian
+ * wide and fullwidth characters, CCS_COMBINING for non-spacing marks,
+ * enclosing marks and format characters, zero otherwise.
+ */
+ccs_code_t ccs_code_width (ccs_code_t c);
+
+/*
+ * Returns the width plane of the character set, see ccs_charset_lazy.
+ */
+const unsigned char *ccs_charset_width (struct ccs_charset *o);
+
+/*
+ * Returns the display width flags of character at the specified row and
+ * column of character set, see ccs_charset_get.
+ */
+static inline
+ccs_code_t ccs_width_get (const struct ccs_charset *o, const unsigned char *w,
+			  unsigned row, unsigned col)
+{
+	return (ccs_code_t) w[row * o->size + col] << CCS_WIDTH_SHIFT;
+}
+
+#endif  /* CCS_WIDTH_H */
@@ -0,0 +1,586 @@
+/*
+ * Coded Character Set Processor
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48, ISO/IEC 10646, RFC 3629
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ccs-control.h>
+#include <ccs-pool.h>
+
+#include "ccs-final.h"
+#include "ccs-impl.h"
+#include "ccs-pool-impl.h"
+#include "ccs-scan.h"
+#include "ccs-width.h"
+
+/*
+ * The parser and the mapping are placed into the same block after the
+ * processor, each one is aligned as for any object.
+ */
+#define ALIGN(n)	(((n) + _Alignof (max_align_t) - 1) & \
+			 ~(_Alignof (max_align_t) - 1))
+
+#define CORE_OFFSET	ALIGN (sizeof (struct ccs))
+#define MAP_OFFSET	(CORE_OFFSET + ALIGN (ccs_core_size ()))
+
+#define CODE_REPLACEMENT	0xfffd
+
+/*
+ * The decoding loop is instantiated for ccs_decode and ccs_next, the latter
+ * is called per data element by ccs_dispatch.
+ */
+#ifdef __GNUC__
+#define INLINE	inline __attribute__ ((always_inline))
+#else
+#define INLINE	inline
+#endif
+
+size_t ccs_size (void)
+{
+	return MAP_OFFSET + ccs_map_size ();
+}
+
+struct ccs *ccs_init (void *buf, size_t size)
+{
+	struct ccs *o = buf;
+	char *p = buf;
+	size_t i;
+
+	if (size < ccs_size ()) {
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	if (ccs_pool_default () == NULL)
+		return NULL;
+
+	o->core = ccs_core_init (p + CORE_OFFSET, ccs_core_size ());
+	o->map  = ccs_map_init  (p + MAP_OFFSET,  ccs_map_size ());
+
+	for (i = 0; i < 6; ++i)
+		o->key[i] = 0;
+
+	o->irr  = 0;
+	o->utf8 = 0;
+	o->need = 0;
+	return o;
+}
+
+void ccs_fini (struct ccs *o)
+{
+	ccs_map_fini (o->map);
+}
+
+struct ccs *ccs_alloc (void)
+{
+	struct ccs *o;
+
+	if ((o = malloc (ccs_size ())) == NULL)
+		return NULL;
+
+	if (ccs_init (o, ccs_size ()) == NULL) {
+		free (o);
+		return NULL;
+	}
+
+	return o;
+}
+
+void ccs_free (struct ccs *o)
+{
+	if (o == NULL)
+		return;
+
+	ccs_fini (o);
+	free (o);
+}
+
+void ccs_set_stream (struct ccs *o, int on)
+{
+	ccs_core_set_stream (o->core, on);
+}
+
+int ccs_set_width (struct ccs *o, int on)
+{
+	return ccs_map_set_width (o->map, on);
+}
+
+void ccs_save (const struct ccs *o, struct ccs_state *s)
+{
+	const struct ccs_core *core = o->core;
+	const struct ccs_map *map = o->map;
+	size_t i;
+
+	memset (s, 0, sizeof (*s));  /* saved states are compared as is */
+
+	for (i = 0; i < 6; ++i)
+		s->set[i] = o->key[i];
+
+	s->gl     = map->gl;
+	s->gr     = map->gr;
+	s->ss     = map->ss;
+	s->irr    = o->irr;
+	s->lead   = map->lead;
+	s->parser = core->state;
+	s->stream = core->stream;
+	s->width  = map->width;
+	s->utf8   = o->utf8;
+
+	if (o->need > 0) {
+		s->need = o->need;
+		s->lo   = o->lo;
+		s->hi   = o->hi;
+		s->part = o->part;
+	}
+
+	if (ccs_core_ground (core))
+		return;  /* the rest is reset on sequence start */
+
+	s->count  = core->count;
+	s->inter  = core->inter;
+	s->len    = core->len;
+	s->code   = core->code;
+}
+
+/*
+ * Returns non-zero if the first octet of multiple-byte character pending
+ * is in range of the set the next character is taken from.
+ */
+static int check_lead (const struct ccs_charset *s, unsigned lead, int *found)
+{
+	if (s == NULL || s->order != 2)
+		return 1;
+
+	*found = 1;
+	return lead <= s->size;
+}
+
+/*
+ * Returns non-zero if the sets can be loaded into the map with the state
+ * specified.
+ */
+static int
+check_sets (struct ccs_charset *set[6], const struct ccs_state *s)
+{
+	int i, found = 0;
+
+	for (i = 0; i < 2; ++i)
+		if (set[i] != NULL && set[i]->order != 1)
+			return 0;
+
+	for (i = 2; i < 6; ++i)
+		if (set[i] != NULL && set[i]->order > 2)
+			return 0;
+
+	if (s->lead == 0)
+		return 1;
+
+	if (s->ss != 0)
+		return check_lead (set[1 + s->ss], s->lead, &found) && found;
+
+	return check_lead (set[2 + s->gl], s->lead, &found) &&
+	       check_lead (set[2 + s->gr], s->lead, &found) && found;
+}
+
+/*
+ * Returns non-zero if the UTF-8 character pending, if any, is valid: it
+ * is collected outside of control strings only.
+ */
+static int check_utf8 (const struct ccs_state *s)
+{
+	if (s->utf8 > 1 || s->need > 3)
+		return 0;
+
+	return s->need == 0 ||
+	       (s->utf8 && s->parser < CCS_CORE_STRING &&
+		s->lo >= 0x80 && s->lo <= s->hi && s->hi <= 0xbf);
+}
+
+int ccs_restore (struct ccs *o, const struct ccs_state *s)
+{
+	struct ccs_pool *pool = ccs_pool_default ();
+	struct ccs_charset *set[6];
+	size_t i, n;
+	int ok = 0;
+
+	if (s->gl > 3 || s->gr < 1 || s->gr > 3 || s->ss > 4 ||
+	    s->parser > CCS_CORE_STRING_ESC || s->width > 1 ||
+	    !check_utf8 (s)) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	for (n = 0; n < 6; ++n)
+		if (s->set[n] == 0)
+			set[n] = NULL;
+		else if ((set[n] = ccs_pool_get_key (pool, s->set[n])) == NULL)
+			goto error;
+
+	if (!check_sets (set, s)) {
+		errno = EINVAL;
+		goto error;
+	}
+
+	for (i = 2; i < 6; ++i)  /* width planes are built on first use */
+		if ((s->width || o->map->width) && set[i] != NULL &&
+		    ccs_charset_width (set[i]) == NULL)
+			goto error;
+
+	for (i = 0; i < 6; ++i) {
+		i < 2 ? ccs_map_load_cs (o->map, i, set[i]) :
+			ccs_map_load_gs (o->map, i - 2, set[i]);
+
+		o->key[i] = s->set[i];
+	}
+
+	ccs_map_lock_gl (o->map, s->gl);
+	ccs_map_lock_gr (o->map, s->gr);
+	ccs_map_set_width (o->map, s->width);
+
+	o->map->ss   = s->ss;
+	o->map->lead = s->lead;
+	o->irr       = s->irr;
+	o->utf8      = s->utf8;
+	o->need      = s->need;
+	o->lo        = s->lo;
+	o->hi        = s->hi;
+	o->part      = s->part;
+
+	o->core->state  = s->parser;
+	o->core->count  = s->count;
+	o->core->inter  = s->inter;
+	o->core->len    = s->len;
+	o->core->stream = s->stream;
+	o->core->utf8   = s->utf8;
+	o->core->code   = s->code;
+	o->core->span   = NULL;
+	ok = 1;
+error:
+	for (i = 0; i < n; ++i)
+		ccs_charset_free (set[i]);
+
+	return ok;
+}
+
+/*
+ * Returns non-zero if the designation is processed, otherwise the set is
+ * unknown and the data element should be passed to the caller.
+ */
+static int designate (struct ccs *o, struct ccs_de *de)
+{
+	struct ccs_charset *s;
+	int type, i, ok;
+
+	if (o->irr != 0 && de->len + 1 < de->size) {
+		de->arg[de->len++] = o->irr;
+		de->arg[de->len] = '\0';
+	}
+
+	o->irr = 0;
+
+	if ((s = ccs_pool_get_charset (ccs_pool_default (), de)) == NULL)
+		return 0;
+
+	switch (de->code) {
+	case CCS_CZD:
+		i = 0;
+		break;
+	case CCS_C1D:
+		i = 1;
+		break;
+	case CCS_GDM:
+		type = de->arg[0] >= CCS_T_GZD4 && de->arg[0] <= CCS_T_G3D6 ?
+		       de->arg[0] : CCS_T_GZD4;  /* ESC 02/04 F is G0 */
+		i = 2 + (type & 3);
+		break;
+	default:
+		i = 2 + (de->code & 3);
+	}
+
+	ok = i < 2 ? ccs_map_load_cs (o->map, i, s) :
+		     ccs_map_load_gs (o->map, i - 2, s);
+
+	if (ok)
+		o->key[i] = ccs_charset_key (de);
+
+	ccs_charset_free (s);
+	return ok;
+}
+
+/*
+ * Returns non-zero if the coding system is switched: ESC 02/05 04/07
+ * designates UTF-8, ESC 02/05 04/00 returns to ECMA-35. The designations
+ * are kept while UTF-8 is in effect, but the characters are not mapped.
+ */
+static int docs (struct ccs *o, const struct ccs_de *de)
+{
+	if (de->len != 1 || (de->data[0] != 'G' && de->data[0] != '@'))
+		return 0;
+
+	o->utf8 = o->core->utf8 = de->data[0] == 'G';
+	o->need = 0;
+	o->map->ss = o->map->lead = 0;
+	return 1;
+}
+
+/*
+ * Processes designation, invocation and shift functions and designation
+ * of coding system. Returns zero if the data element is consumed.
+ */
+static int control (struct ccs *o, struct ccs_de *de)
+{
+	switch (de->code) {
+	case CCS_LS0:	return !ccs_map_lock_gl  (o->map, 0);
+	case CCS_LS1:	return !ccs_map_lock_gl  (o->map, 1);
+	case CCS_LS2:	return !ccs_map_lock_gl  (o->map, 2);
+	case CCS_LS3:	return !ccs_map_lock_gl  (o->map, 3);
+	case CCS_LS1R:	return !ccs_map_lock_gr  (o->map, 1);
+	case CCS_LS2R:	return !ccs_map_lock_gr  (o->map, 2);
+	case CCS_LS3R:	return !ccs_map_lock_gr  (o->map, 3);
+	case CCS_SS2:	return !ccs_map_shift_gl (o->map, 2);
+	case CCS_SS3:	return !ccs_map_shift_gl (o->map, 3);
+	case CCS_IRR:
+		o->irr = de->len > 0 ? de->data[0] : 0;
+		return 0;
+	case CCS_CZD:
+	case CCS_C1D:
+	case CCS_GDM:
+	case CCS_GZD4: case CCS_G1D4: case CCS_G2D4: case CCS_G3D4:
+	case CCS_G1D6: case CCS_G2D6: case CCS_G3D6:
+		ccs_core_spill (o->core, de);  /* sets are looked up by arg */
+		return !designate (o, de);
+	case CCS_DOCS:
+		return !docs (o, de);
+	}
+
+	return 1;
+}
+
+/*
+ * Maps the data element produced by parser, returns zero if it is consumed
+ */
+static int map (struct ccs *o, struct ccs_de *de)
+{
+	if (de->code <= 0xff &&
+	    (de->code = ccs_map_process (o->map, de->code)) == 0)
+		return 0;
+
+	return control (o, de);
+}
+
+/*
+ * Starts UTF-8 character by its lead octet, returns zero if the octet is
+ * not a lead one. The range of the second octet excludes overlong forms,
+ * surrogates and codes above U+10FFFF, see Table 3-7 of The Unicode
+ * Standard.
+ */
+static int utf8_start (struct ccs *o, unsigned c)
+{
+	if (c < 0xc2 || c > 0xf4)
+		return 0;
+
+	o->need = c < 0xe0 ? 1 : c < 0xf0 ? 2 : 3;
+	o->part = c & (0x3f >> o->need);
+	o->lo   = c == 0xe0 ? 0xa0 : c == 0xf0 ? 0x90 : 0x80;
+	o->hi   = c == 0xed ? 0x9f : c == 0xf4 ? 0x8f : 0xbf;
+	return 1;
+}
+
+/*
+ * While UTF-8 is in effect the octets below 08/00 and the content of
+ * control strings are passed to parser as is, other octets are decoded
+ * into characters passed to parser as codes: thus C1 controls are coded
+ * as U+0080 — U+009F. An ill-formed sequence gives U+FFFD: if the octet
+ * breaks the character pending, the octet should be processed again.
+ */
+static int process_utf8 (struct ccs *o, ccs_code_t c, const unsigned char *at,
+			 struct ccs_de *de)
+{
+	ccs_code_t code = CODE_REPLACEMENT;
+
+	if (o->need > 0 && (c < o->lo || c > o->hi)) {
+		o->need = 0;
+		ccs_core_process (o->core, code, de);
+		return CCS_AGAIN;
+	}
+
+	if (c < 0x80 || c > 0xff || o->core->state >= CCS_CORE_STRING)
+		return (at != NULL ? ccs_core_process_at (o->core, at, de) :
+				     ccs_core_process (o->core, c, de)) &&
+		       control (o, de);
+
+	if (o->need > 0) {
+		o->part = o->part << 6 | (c & 0x3f);
+		o->lo   = 0x80;
+		o->hi   = 0xbf;
+
+		if (--o->need > 0)
+			return 0;
+
+		code = o->part;
+
+		if (o->map->width)
+			code |= ccs_code_width (code);
+	}
+	else if (utf8_start (o, c))
+		return 0;
+
+	return ccs_core_process (o->core, code, de) && control (o, de);
+}
+
+/*
+ * Per-code calls pass U+FFFD and the code of octet processed again as a
+ * text run of two codes, if that octet gives a code.
+ */
+static int process_utf8_code (struct ccs *o, ccs_code_t c, struct ccs_de *de)
+{
+	int ret;
+
+	if ((ret = process_utf8 (o, c, NULL, de)) != CCS_AGAIN)
+		return ret;
+
+	if (!process_utf8 (o, c, NULL, de)) {
+		de->code = CODE_REPLACEMENT;
+		de->len  = 0;
+		return 1;
+	}
+
+	o->run[0] = CODE_REPLACEMENT;
+	o->run[1] = de->code;
+
+	de->code = CCS_TEXT;
+	de->len  = 2;
+	de->text = o->run;
+	return 1;
+}
+
+int ccs_process (struct ccs *o, ccs_code_t c, struct ccs_de *de)
+{
+	if (o->utf8)
+		return process_utf8_code (o, c, de);
+
+	return ccs_core_process (o->core, c, de) && map (o, de);
+}
+
+int ccs_process_at (struct ccs *o, const unsigned char *p, struct ccs_de *de)
+{
+	if (o->utf8)
+		return process_utf8 (o, *p, p, de);
+
+	return ccs_core_process_at (o->core, p, de) && map (o, de);
+}
+
+/*
+ * Returns non-zero if the octet gives a graphic character or nothing, thus
+ * it can be added to the text run being collected.
+ */
+static int is_graphic (const struct ccs *o, unsigned c)
+{
+	return ccs_core_ground (o->core) && (c & 0x7f) >= 0x20;
+}
+
+/*
+ * Decodes codes from the input into the buffer of count codes until it is
+ * full or an element with argument is found. If text is set, a control
+ * function ends the collection as well, and so does any octet that is not
+ * graphic once the buffer is not empty, thus only a text run is collected.
+ * Returns non-zero if the element found is left in de. The data element
+ * should be detached by caller.
+ */
+static INLINE int collect (struct ccs *o, const unsigned char **in,
+			   const unsigned char *end, ccs_code_t *out,
+			   size_t *count, int text, struct ccs_de *de)
+{
+	const unsigned char *p = *in;
+	size_t size = *count, n = 0, left, run, k;
+	int found = 0;
+
+	while (p < end && n < size) {
+		left = (size_t) (end - p);
+
+		if ((unsigned) (*p - 0x20) < 0x60 && ccs_gl_direct (o)) {
+			run = left < size - n ? left : size - n;
+
+			if ((run = ccs_scan_gl (p, run)) > 0) {
+				n += ccs_map_gl_run (o->map, p, run, out + n);
+				p += run;
+				continue;
+			}
+		}
+		else if (ccs_utf8_direct (o)) {
+			k = size - n;
+
+			run = ccs_utf8_text (o, p, left, out + n, &k);
+
+			if (run > 0) {
+				n += k;
+				p += run;
+				continue;
+			}
+		}
+
+		if (text && n > 0 && !is_graphic (o, *p))
+			break;
+
+		if ((run = ccs_string_run (o, p, left, de)) > 0) {
+			p += run;
+			continue;
+		}
+
+		if (!ccs_process_step (o, &p, de))
+			continue;
+
+		if (de->len == 0 && (!text || ccs_is_text (de->code))) {
+			out[n++] = de->code;
+			continue;
+		}
+
+		found = 1;
+		break;
+	}
+
+	*in    = p;
+	*count = n;
+	return found;
+}
+
+size_t ccs_decode (struct ccs *o, const void *in, size_t len,
+		   ccs_code_t *out, size_t *count, struct ccs_de *de)
+{
+	const unsigned char *p = in;
+
+	if (!collect (o, &p, p + len, out, count, 0, de))
+		de->len = 0;
+
+	ccs_core_detach (o->core, de);
+	return p - (const unsigned char *) in;
+}
+
+int ccs_next (struct ccs *o, const void *in, size_t *len, struct ccs_de *de)
+{
+	const unsigned char *p = in;
+	size_t n = CCS_RUN_MAX;
+	int found = collect (o, &p, p + *len, o->run, &n, 1, de);
+
+	ccs_core_detach (o->core, de);
+	*len = p - (const unsigned char *) in;
+
+	if (found)
+		return 1;  /* control function, no text run pending */
+
+	if (n == 0)
+		return 0;
+
+	de->code = CCS_TEXT;
+	de->len  = n;
+	de->text = o->run;
+	return 1;
+}
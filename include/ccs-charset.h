@@ -18,6 +18,7 @@ struct ccs_charset *ccs_charset_alloc (const char *name);
 void ccs_charset_free (struct ccs_charset *o);
 
 const char *ccs_charset_merge (struct ccs_charset *o, const char *name);
+const char *ccs_charset_save  (const struct ccs_charset *o, FILE *f);
 
 struct ccs_charset *ccs_charset_locate (const struct ccs_de *de);
 
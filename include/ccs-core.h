@@ -10,11 +10,18 @@
 #ifndef CCS_CORE_H
 #define CCS_CORE_H  1
 
+#include <stddef.h>
+
 #include <ccs-types.h>
 
 struct ccs_core *ccs_core_alloc (void);
 void ccs_core_free (struct ccs_core *o);
 
+size_t ccs_core_size (void);
+struct ccs_core *ccs_core_init (void *buf, size_t size);
+
+void ccs_core_set_stream (struct ccs_core *o, int on);
+
 int ccs_core_process (struct ccs_core *o, ccs_code_t c, struct ccs_de *de);
 
 #endif  /* CCS_CORE_H */
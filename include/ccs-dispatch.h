@@ -0,0 +1,32 @@
+/*
+ * Coded Character Set Callback Dispatch
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_DISPATCH_H
+#define CCS_DISPATCH_H  1
+
+#include <stddef.h>
+
+#include <ccs.h>
+
+typedef void ccs_text_fn (void *cookie, const ccs_code_t *text, size_t len);
+typedef int ccs_control_fn (void *cookie, const struct ccs_de *de);
+
+struct ccs_dispatch *ccs_dispatch_alloc (void);
+void ccs_dispatch_free (struct ccs_dispatch *o);
+
+int ccs_dispatch_set (struct ccs_dispatch *o, ccs_code_t code,
+		      ccs_control_fn *fn);
+void ccs_dispatch_set_text (struct ccs_dispatch *o, ccs_text_fn *fn);
+void ccs_dispatch_set_default (struct ccs_dispatch *o, ccs_control_fn *fn);
+
+size_t ccs_dispatch (const struct ccs_dispatch *d, struct ccs *o,
+		     const void *in, size_t len, struct ccs_de *de,
+		     void *cookie);
+
+#endif  /* CCS_DISPATCH_H */
@@ -0,0 +1,27 @@
+/*
+ * Coded Character Set Encoder
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_ENCODER_H
+#define CCS_ENCODER_H  1
+
+#include <stddef.h>
+
+#include <ccs-types.h>
+
+struct ccs_encoder *ccs_encoder_alloc (void);
+void ccs_encoder_free (struct ccs_encoder *o);
+
+int ccs_encoder_add (struct ccs_encoder *o, const struct ccs_de *de);
+
+size_t ccs_encode (struct ccs_encoder *o, const ccs_code_t *in, size_t len,
+		   void *out, size_t *size);
+
+int ccs_encoder_reset (struct ccs_encoder *o, void *out, size_t *size);
+
+#endif  /* CCS_ENCODER_H */
@@ -0,0 +1,29 @@
+/*
+ * Coded Character Set Checkpoint Index
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_INDEX_H
+#define CCS_INDEX_H  1
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <ccs.h>
+
+struct ccs_index *ccs_index_alloc (size_t step);
+void ccs_index_free (struct ccs_index *o);
+
+int ccs_index_build (struct ccs_index *o, const void *in, size_t len);
+
+const char *ccs_index_save (const struct ccs_index *o, FILE *f);
+struct ccs_index *ccs_index_load (FILE *f);
+
+int ccs_index_seek (const struct ccs_index *o, struct ccs *p,
+		    unsigned long long *offset);
+
+#endif  /* CCS_INDEX_H */
@@ -10,12 +10,18 @@
 #ifndef CCS_MAP_H
 #define CCS_MAP_H  1
 
+#include <stddef.h>
+
 #include <ccs-charset.h>
 #include <ccs-types.h>
 
 struct ccs_map *ccs_map_alloc (void);
 void ccs_map_free (struct ccs_map *o);
 
+size_t ccs_map_size (void);
+struct ccs_map *ccs_map_init (void *buf, size_t size);
+void ccs_map_fini (struct ccs_map *o);
+
 int ccs_map_load_cs (struct ccs_map *o, int i, struct ccs_charset *s);
 int ccs_map_load_gs (struct ccs_map *o, int i, struct ccs_charset *s);
 
@@ -23,6 +29,11 @@ int ccs_map_lock_gl  (struct ccs_map *o, int i);
 int ccs_map_lock_gr  (struct ccs_map *o, int i);
 int ccs_map_shift_gl (struct ccs_map *o, int i);
 
+int ccs_map_set_width (struct ccs_map *o, int on);
+
 ccs_code_t ccs_map_process (struct ccs_map *o, ccs_code_t c);
 
+void ccs_map_process_block (struct ccs_map *o, const unsigned char *in,
+			    size_t len, ccs_code_t *out);
+
 #endif  /* CCS_MAP_H */
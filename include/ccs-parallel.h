@@ -0,0 +1,29 @@
+/*
+ * Coded Character Set Parallel Decoder
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_PARALLEL_H
+#define CCS_PARALLEL_H  1
+
+#include <stddef.h>
+
+#include <ccs.h>
+
+struct ccs_parallel_conf {
+	unsigned	threads;	/* worker threads, 0 for CPU count */
+	size_t		chunk;		/* chunk size, 0 for default	*/
+	ccs_size_t	size;		/* argument buffer size		*/
+};
+
+typedef int ccs_output_fn (void *cookie, const struct ccs_de *de);
+
+int ccs_decode_parallel (const void *in, size_t len,
+			 const struct ccs_parallel_conf *conf,
+			 ccs_output_fn *fn, void *cookie);
+
+#endif  /* CCS_PARALLEL_H */
@@ -10,13 +10,28 @@
 #ifndef CCS_POOL_H
 #define CCS_POOL_H  1
 
+#include <stddef.h>
+
 #include <ccs-charset.h>
 #include <ccs-types.h>
 
+struct ccs_pool_stats {
+	size_t		bytes;		/* current table memory		*/
+	size_t		limit;		/* memory limit, 0 if unlimited	*/
+	unsigned long	hits;		/* lookups served from cache	*/
+	unsigned long	misses;		/* lookups loading charsets	*/
+	unsigned long	evictions;	/* charsets evicted		*/
+};
+
 struct ccs_pool *ccs_pool_alloc (void);
 void ccs_pool_free (struct ccs_pool *o);
 
+struct ccs_pool *ccs_pool_default (void);
+
 struct ccs_charset *
 ccs_pool_get_charset (struct ccs_pool *o, const struct ccs_de *de);
 
+void ccs_pool_set_limit (struct ccs_pool *o, size_t limit);
+void ccs_pool_get_stats (struct ccs_pool *o, struct ccs_pool_stats *s);
+
 #endif  /* CCS_POOL_H */
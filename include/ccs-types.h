@@ -20,10 +20,29 @@ typedef unsigned ccs_code_t;
 
 typedef unsigned short ccs_size_t;
 
+#define CCS_PARAM_MAX	16
+#define CCS_TEXT	0xd0000000	/* run of graphic characters	*/
+#define CCS_CHUNK	0xd0000001	/* part of control string	*/
+
+#define CCS_WIDE	0x01000000	/* character takes two columns	*/
+#define CCS_COMBINING	0x02000000	/* character takes no column	*/
+#define CCS_WIDTH_MASK	(CCS_WIDE | CCS_COMBINING)
+
+struct ccs_param {
+	unsigned char	count;	/* number of parameters		*/
+	unsigned char	mark;	/* private parameter marker	*/
+	unsigned short	sub;	/* sub-parameter flags		*/
+	unsigned short	omit;	/* default value flags		*/
+	unsigned short	value[CCS_PARAM_MAX];
+};
+
 struct ccs_de {
 	ccs_code_t	code;	/* character code		*/
 	ccs_size_t	size;	/* argument buffer size		*/
 	ccs_size_t	len;	/* actual length of argument	*/
+	const ccs_code_t *text;	/* characters of text run	*/
+	const unsigned char *data;	/* argument			*/
+	struct ccs_param param;	/* control sequence parameters	*/
 	unsigned char	arg[];	/* argument buffer		*/
 };
 
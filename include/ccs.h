@@ -0,0 +1,59 @@
+/*
+ * Coded Character Set Processor
+ *
+ * Copyright (c) 2020 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * Standard: ECMA-35, ECMA-48
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CCS_H
+#define CCS_H  1
+
+#include <stddef.h>
+
+#include <ccs-types.h>
+
+struct ccs_state {
+	ccs_code_t	set[6];	/* keys of C0, C1, G0 — G3 sets	*/
+	unsigned char	gl, gr;	/* sets invoked into GL and GR	*/
+	unsigned char	ss;	/* single shift pending		*/
+	unsigned char	irr;	/* revision byte from IRR	*/
+	unsigned short	lead;	/* multiple-byte character	*/
+	unsigned char	parser;	/* parser state			*/
+	unsigned char	count;	/* number of intermediate bytes	*/
+	unsigned short	inter;	/* intermediate bytes		*/
+	ccs_size_t	len;	/* length of argument collected	*/
+	unsigned char	stream;	/* stream mode of control strings */
+	unsigned char	width;	/* display width flags enabled	*/
+	ccs_code_t	code;	/* code of sequence being parsed */
+	unsigned char	utf8;	/* UTF-8 coding system in effect */
+	unsigned char	need;	/* UTF-8 continuation octets	*/
+	unsigned char	lo, hi;	/* range of the next one	*/
+	ccs_code_t	part;	/* UTF-8 character pending	*/
+};
+
+struct ccs *ccs_alloc (void);
+void ccs_free (struct ccs *o);
+
+size_t ccs_size (void);
+struct ccs *ccs_init (void *buf, size_t size);
+void ccs_fini (struct ccs *o);
+
+void ccs_set_stream (struct ccs *o, int on);
+int ccs_set_width (struct ccs *o, int on);
+
+void ccs_save (const struct ccs *o, struct ccs_state *s);
+int ccs_restore (struct ccs *o, const struct ccs_state *s);
+
+int ccs_process (struct ccs *o, ccs_code_t c, struct ccs_de *de);
+
+size_t ccs_decode (struct ccs *o, const void *in, size_t len,
+		   ccs_code_t *out, size_t *count, struct ccs_de *de);
+
+int ccs_next (struct ccs *o, const void *in, size_t *len, struct ccs_de *de);
+
+int ccs_decode_utf8 (struct ccs *o, const void *in, size_t *len,
+		     void *out, size_t *size, struct ccs_de *de);
+
+#endif  /* CCS_H */